@@ -8,6 +8,28 @@
 
 namespace transport_catalogue {
 
+    namespace detail {
+
+        std::string_view NamePool::Add(std::string_view name) {
+            if (name.size() > free_size_) {
+                // Длинное имя получает свой блок, чтобы не бросать остаток текущего
+                if (name.size() > BLOCK_SIZE / 4) {
+                    char* block = blocks_.emplace_back(std::make_unique<char[]>(name.size())).get();
+                    std::copy(name.begin(), name.end(), block);
+                    return { block, name.size() };
+                }
+                free_ = blocks_.emplace_back(std::make_unique<char[]>(BLOCK_SIZE)).get();
+                free_size_ = BLOCK_SIZE;
+            }
+            char* stored = free_;
+            std::copy(name.begin(), name.end(), stored);
+            free_ += name.size();
+            free_size_ -= name.size();
+            return { stored, name.size() };
+        }
+
+    } // namespace detail
+
     namespace stop_catalogue {
 
         using namespace detail;
@@ -32,29 +54,32 @@ namespace transport_catalogue {
 /// лучше тогда переделать в универсальные ссылки
 
         const Stop* Catalogue::Push(std::string&& name, std::string&& string_coord) {	/// зачем move-семантика для string_coord? в методе дальше не передается
-            return Push(std::move(name), Coordinates::ParseFromStringView(string_coord));
+            return Push(name, Coordinates::ParseFromStringView(string_coord));
         }
 
-        const Stop* Catalogue::Push(std::string&& name, Coordinates&& coord) {		/// Coordinates - тип без динамического выделения памяти, нет смысла использовать move-семантику
-            const Stop* stop = CatalogueTemplate::PushData({ std::move(name), std::move(coord) });
-            stop_buses_.insert({ stop, {} });
+        const Stop* Catalogue::Push(std::string_view name, Coordinates coord) {
+            const Stop* stop = PushRow(name);
+            GetColumns().coordinates.push_back(coord);
+            GetColumns().buses.emplace_back();
             return stop;
         }
 
-        const Stop* Catalogue::Push(size_t id, std::string&& name, Coordinates&& coord) {
-            const Stop* stop = CatalogueTemplate::PushData(id, { std::move(name), std::move(coord) });
-            stop_buses_.insert({ stop, {} });
+        const Stop* Catalogue::Push(size_t id, std::string_view name, Coordinates coord) {
+            const Stop* stop = PushRow(id, name);
+            GetColumns().coordinates.push_back(coord);
+            GetColumns().buses.emplace_back();
             return stop;
         }
 
-        const Stop* Catalogue::Push(size_t id, Stop&& stop_value) {
-            const Stop* stop = CatalogueTemplate::PushData(id, std::move(stop_value));
-            stop_buses_.insert({ stop, {} });
-            return stop;
+        void Catalogue::Reserve(size_t stop_count, size_t distance_count) {
+            ReserveRows(stop_count);
+            GetColumns().coordinates.reserve(stop_count);
+            GetColumns().buses.reserve(stop_count);
+            distances_between_stops_.reserve(distance_count);
         }
 
-        void Catalogue::PushBusToStop(const Stop* stop, const std::string_view& bus_name) {	/// string_view считается простым типом, достаточно передавать по значению
-            stop_buses_.at(stop).insert(bus_name);
+        void Catalogue::PushBusToStop(const Stop* stop, std::string_view bus_name) {
+            GetColumns().buses.at(stop->GetRow()).insert(bus_name);
         }
 
         void Catalogue::AddDistance(const Stop* stop_1, const Stop* stop_2, double distance) {
@@ -75,8 +100,9 @@ namespace transport_catalogue {
         using namespace detail;
         using namespace stop_catalogue;
 
-        Bus BusHelper::Build(const stop_catalogue::Catalogue& stops_catalogue) {
-            Bus bus;
+        BusData BusHelper::Build(const stop_catalogue::Catalogue& stops_catalogue) {
+            BusData bus;
+            bus.route = std::move(route_);
 
             for (const std::string_view& stop_name : stop_names_) {
                 auto stop = stops_catalogue.At(stop_name);
@@ -89,14 +115,13 @@ namespace transport_catalogue {
             bus.route_type = route_type_;
             bus.route_geo_length = CalcRouteGeoLength(bus.route, route_type_);
             bus.route_true_length = CalcRouteTrueLength(bus.route, stops_catalogue.GetDistances(), route_type_);
-            bus.stops_on_route = bus.route.size();
-            bus.route_settings = std::move(settings_);
+            bus.stops_on_route = static_cast<uint32_t>(bus.route.size());
 
             std::unordered_set<std::string_view> unique_stops_names;
             for (const Stop* stop : bus.route) {
-                unique_stops_names.insert(stop->name);
+                unique_stops_names.insert(stop->GetName());
             }
-            bus.unique_stops = unique_stops_names.size();
+            bus.unique_stops = static_cast<uint32_t>(unique_stops_names.size());
 
             if (route_type_ == RouteType::BackAndForth && bus.stops_on_route > 0) {
                 bus.stops_on_route = bus.stops_on_route * 2 - 1;
@@ -105,7 +130,7 @@ namespace transport_catalogue {
             return bus;
         }
 
-        double BusHelper::CalcRouteGeoLength(const std::deque<const Stop*>& route, RouteType route_type) const {
+        double BusHelper::CalcRouteGeoLength(const std::vector<const Stop*>& route, RouteType route_type) const {
             double length = 0.0;
             if (route.size() > 0) {
                 std::vector<double> distance(route.size());
@@ -113,7 +138,7 @@ namespace transport_catalogue {
                     route.begin(), route.end() - 1,
                     route.begin() + 1, distance.begin(),
                     [](const Stop* from, const Stop* to) {
-                        return ComputeDistance(from->coord, to->coord);
+                        return ComputeDistance(from->GetCoordinates(), to->GetCoordinates());
                     });
                 length = std::reduce(distance.begin(), distance.end());
 
@@ -124,7 +149,7 @@ namespace transport_catalogue {
             return length;
         }
 
-        double BusHelper::CalcRouteTrueLength(const std::deque<const Stop*>& route, const DistancesContainer& stops_distances, RouteType route_type) const {
+        double BusHelper::CalcRouteTrueLength(const std::vector<const Stop*>& route, const DistancesContainer& stops_distances, RouteType route_type) const {
             double length = 0.0;
             if (route.size() > 0) {
                 std::vector<double> distance(route.size());
@@ -160,15 +185,63 @@ namespace transport_catalogue {
             static const char* str_route_length = "route length";
             static const char* str_curvature = "curvature";
 
-            double curvature = bus.route_true_length / bus.route_geo_length;
+            double curvature = bus.GetRouteTrueLength() / bus.GetRouteGeoLength();
 
-            out << str_bus << bus.name << str_sep;
-            out << bus.stops_on_route << str_space << str_stops_on_route << str_comma;
-            out << bus.unique_stops << str_space << str_unique_stops << str_comma;
-            out << std::setprecision(6) << bus.route_true_length << str_space << str_route_length << str_comma;
+            out << str_bus << bus.GetName() << str_sep;
+            out << bus.GetStopsOnRoute() << str_space << str_stops_on_route << str_comma;
+            out << bus.GetUniqueStops() << str_space << str_unique_stops << str_comma;
+            out << std::setprecision(6) << bus.GetRouteTrueLength() << str_space << str_route_length << str_comma;
             out << std::setprecision(6) << curvature << str_space << str_curvature;
 
             return out;
         }
+
+        const Bus* Catalogue::Push(BusData&& data, const stop_catalogue::Catalogue& stops) {
+            const Bus* bus = PushRow(data.name);
+            PushColumns(std::move(data), stops);
+            return bus;
+        }
+
+        const Bus* Catalogue::Push(size_t id, BusData&& data, const stop_catalogue::Catalogue& stops) {
+            const Bus* bus = PushRow(id, data.name);
+            PushColumns(std::move(data), stops);
+            return bus;
+        }
+
+        void Catalogue::Reserve(size_t bus_count, size_t route_stop_count) {
+            ReserveRows(bus_count);
+            BusColumns& columns = GetColumns();
+            columns.route_stops.reserve(route_stop_count);
+            columns.routes.reserve(bus_count);
+            columns.route_types.reserve(bus_count);
+            columns.route_geo_lengths.reserve(bus_count);
+            columns.route_true_lengths.reserve(bus_count);
+            columns.stops_on_route.reserve(bus_count);
+            columns.unique_stops.reserve(bus_count);
+        }
+
+        void Catalogue::PushColumns(BusData&& data, const stop_catalogue::Catalogue& stops) {
+            BusColumns& columns = GetColumns();
+            if (!columns.stops) {
+                columns.stops = &stops.GetColumns();
+            }
+            else if (columns.stops != &stops.GetColumns()) {
+                throw std::logic_error("Bus route refers to another stop catalogue");
+            }
+
+            const auto offset = static_cast<uint32_t>(columns.route_stops.size());
+            for (const Stop* stop : data.route) {
+                if (!stops.Contains(stop)) {
+                    throw std::logic_error("Bus route refers to unknown stop");
+                }
+                columns.route_stops.push_back(stop->GetRow());
+            }
+            columns.routes.push_back({ offset, static_cast<uint32_t>(data.route.size()) });
+            columns.route_types.push_back(data.route_type);
+            columns.route_geo_lengths.push_back(data.route_geo_length);
+            columns.route_true_lengths.push_back(data.route_true_length);
+            columns.stops_on_route.push_back(data.stops_on_route);
+            columns.unique_stops.push_back(data.unique_stops);
+        }
     } // namespace bus_catalogue
 } // namespace transport_catalogue
\ No newline at end of file
@@ -1,13 +1,20 @@
 #pragma once
 
 #include <cassert>
+#include <cstdint>
 #include <deque>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
 #include <optional>
 #include <set>
+#include <stdexcept>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "geo.h"
 
@@ -40,46 +47,91 @@ namespace transport_catalogue {
 
     namespace detail {
 
-        template <typename Type>
-        class CatalogueTemplate {
+        /*
+        * Пул строк для имён каталога. Строки выделяются блоками и не перемещаются,
+        * поэтому на них можно ссылаться через std::string_view, пока жив пул
+        */
+        class NamePool {
+        public:
+            std::string_view Add(std::string_view name);
+
+        private:
+            static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+            std::vector<std::unique_ptr<char[]>> blocks_ = {};
+            char* free_ = nullptr;
+            size_t free_size_ = 0;
+        };
+
+        /*
+        * Дескриптор строки столбцового каталога: номер строки в столбцах и внешний номер элемента.
+        * Адрес дескриптора не меняется, пока жив каталог, и служит идентификатором элемента
+        */
+        class Row {
         public:
-            CatalogueTemplate() = default;
+            Row(uint32_t row, uint32_t id)
+                : row_(row)
+                , id_(id) {
+            }
 
-            const Type* PushData(Type&& data) {
-                return PushData(id_to_data_.size(), std::move(data));
+            uint32_t GetRow() const {
+                return row_;
             }
 
-            const Type* PushData(size_t id, Type&& data) {
-                const Type& emplaced = data_.emplace_back(data);
-                name_to_data_.emplace(emplaced.name, &emplaced);
-                id_to_data_.emplace(id, &emplaced);
-                data_to_id_.emplace(&emplaced, id);
-                return &emplaced;
+            uint32_t GetId() const {
+                return id_;
+            }
+
+        private:
+            uint32_t row_ = 0;
+            uint32_t id_ = 0;
+        };
+
+        /*
+        * Основа столбцового каталога. Свойства элементов хранятся в Columns отдельными
+        * векторами, строка которых - порядковый номер добавления элемента. Columns также
+        * хранит дескрипторы Type и столбец имён, а сам лежит в куче, поэтому указатели
+        * на дескрипторы переживают перемещение каталога
+        */
+        template <typename Type, typename Columns>
+        class CatalogueTemplate {
+        public:
+            CatalogueTemplate()
+                : columns_(std::make_unique<Columns>()) {
             }
 
             size_t Size() const {
-                return data_.size();
+                return columns_->handles.size();
             }
 
             std::optional<const Type*> At(std::string_view name) const {
-                if (name_to_data_.count(name) > 0) {
-                    return name_to_data_.at(name);
+                if (auto it = name_to_data_.find(name); it != name_to_data_.end()) {
+                    return it->second;
                 }
                 return std::nullopt;
             }
 
             std::optional<const Type*> At(size_t id) const {
-                if (id_to_data_.count(id) > 0) {
-                    return id_to_data_.at(id);
+                if (id < id_to_data_.size() && id_to_data_[id]) {
+                    return id_to_data_[id];
                 }
                 return std::nullopt;
             }
 
+            bool Contains(const Type* data) const {
+                return data && data->GetRow() < Size() && &columns_->handles[data->GetRow()] == data;
+            }
+
             size_t GetId(const Type* data) const {
-                if (!data || !data_to_id_.count(data)) {
+                if (!Contains(data)) {
                     throw std::logic_error("Couldn't find this data or data is nullptr");
                 }
-                return data_to_id_.at(data);
+                return data->GetId();
+            }
+
+            // Столбцы каталога, для просмотра одного свойства всех элементов подряд
+            const Columns& GetColumns() const {
+                return *columns_;
             }
 
             auto begin() const {
@@ -90,11 +142,45 @@ namespace transport_catalogue {
                 return name_to_data_.end();
             }
 
+        protected:
+            // Добавляет строку с дескриптором и именем, остальные столбцы строки заполняет наследник
+            const Type* PushRow(std::string_view name) {
+                return PushRow(id_to_data_.size(), name);
+            }
+
+            const Type* PushRow(size_t id, std::string_view name) {
+                if (id > std::numeric_limits<uint32_t>::max() || Size() >= std::numeric_limits<uint32_t>::max()) {
+                    throw std::logic_error("Catalogue is too large");
+                }
+                const auto row = static_cast<uint32_t>(Size());
+                const Type& emplaced = columns_->handles.emplace_back(columns_.get(), row, static_cast<uint32_t>(id));
+                const std::string_view stored = names_.Add(name);
+                columns_->names.push_back(stored);
+                name_to_data_.emplace(stored, &emplaced);
+                if (id >= id_to_data_.size()) {
+                    id_to_data_.resize(id + 1, nullptr);
+                }
+                id_to_data_[id] = &emplaced;
+                return &emplaced;
+            }
+
+            // Индекс по именам не резервируется: от числа его корзин зависит порядок обхода,
+            // а по нему нумеруются вершины графа маршрутов и разрешаются равные по времени маршруты
+            void ReserveRows(size_t count) {
+                columns_->names.reserve(count);
+                id_to_data_.reserve(count);
+            }
+
+            Columns& GetColumns() {
+                return *columns_;
+            }
+
         private:
-            std::deque<Type> data_ = {};
+            std::unique_ptr<Columns> columns_;
+            NamePool names_ = {};
             std::unordered_map<std::string_view, const Type*> name_to_data_ = {};
-            std::unordered_map<size_t, const Type*> id_to_data_ = {};
-            std::unordered_map<const Type*, size_t> data_to_id_ = {};
+            // Плотный индекс id -> элемент, id выдаются подряд начиная с нуля
+            std::vector<const Type*> id_to_data_ = {};
         };
 
         template <typename Pointer>
@@ -114,42 +200,70 @@ namespace transport_catalogue {
 
     namespace stop_catalogue {
 
-        struct Stop {
-            std::string name;
-            Coordinates coord;
+        struct StopColumns;
+
+        class Stop : public detail::Row {
+        public:
+            Stop(const StopColumns* columns, uint32_t row, uint32_t id)
+                : Row(row, id)
+                , columns_(columns) {
+            }
+
+            std::string_view GetName() const;
+
+            const Coordinates& GetCoordinates() const;
 
             bool operator== (const Stop& other) const {
-                return name == other.name;
+                return GetName() == other.GetName();
             }
 
             bool operator!= (const Stop& other) const {
                 return !(*this == other);
             }
+
+        private:
+            const StopColumns* columns_;
         };
 
         using BusesToStopNames = std::set<std::string_view>;
         using DistancesContainer = std::unordered_map<detail::PointerPair<Stop>, double, detail::PointerPairHasher<Stop>>;
 
+        // Столбцы остановок, строка - порядковый номер добавления остановки
+        struct StopColumns {
+            std::deque<Stop> handles = {};
+            std::vector<std::string_view> names = {};
+            std::vector<Coordinates> coordinates = {};
+            std::vector<BusesToStopNames> buses = {};
+        };
+
+        inline std::string_view Stop::GetName() const {
+            return columns_->names[GetRow()];
+        }
+
+        inline const Coordinates& Stop::GetCoordinates() const {
+            return columns_->coordinates[GetRow()];
+        }
+
         std::ostream& operator<< (std::ostream& out, const BusesToStopNames& buses);
 
-        class Catalogue : public detail::CatalogueTemplate<Stop> {
+        class Catalogue : public detail::CatalogueTemplate<Stop, StopColumns> {
         public:
             Catalogue() = default;
 
             const Stop* Push(std::string&& name, std::string&& string_coord);
 
-            const Stop* Push(std::string&& name, Coordinates&& coord);
+            const Stop* Push(std::string_view name, Coordinates coord);
 
-            const Stop* Push(size_t id, std::string&& name, Coordinates&& coord);
+            const Stop* Push(size_t id, std::string_view name, Coordinates coord);
 
-            const Stop* Push(size_t id, Stop&& stop_value);
+            void Reserve(size_t stop_count, size_t distance_count);
 
-            void PushBusToStop(const Stop* stop, const std::string_view& bus_name);
+            void PushBusToStop(const Stop* stop, std::string_view bus_name);
 
             void AddDistance(const Stop* stop_1, const Stop* stop_2, double distance);
 
             const BusesToStopNames& GetBuses(const Stop* stop) const {
-                return stop_buses_.at(stop);
+                return GetColumns().buses[stop->GetRow()];
             }
 
             const DistancesContainer& GetDistances() const {
@@ -157,28 +271,255 @@ namespace transport_catalogue {
             }
 
             bool IsEmpty(const Stop* stop) const {
-                return stop_buses_.count(stop) == 0 || stop_buses_.at(stop).empty();
+                return GetBuses(stop).empty();
             }
 
         private:
-            std::unordered_map<const Stop*, BusesToStopNames> stop_buses_ = {};
             DistancesContainer distances_between_stops_ = {};
         };
     } // namespace stop_catalogue
 
     namespace bus_catalogue {
 
-        struct Bus {
+        /*
+        * Итератор по остановкам маршрута. Маршрут хранится номерами строк остановок,
+        * при разыменовании номер переводится в указатель на дескриптор остановки
+        */
+        class RouteIterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = const stop_catalogue::Stop*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const value_type*;
+            using reference = value_type;
+
+            RouteIterator() = default;
+
+            RouteIterator(const uint32_t* position, const stop_catalogue::StopColumns* stops)
+                : position_(position)
+                , stops_(stops) {
+            }
+
+            reference operator*() const {
+                return &stops_->handles[*position_];
+            }
+
+            reference operator[](difference_type n) const {
+                return *(*this + n);
+            }
+
+            RouteIterator& operator++() {
+                ++position_;
+                return *this;
+            }
+
+            RouteIterator operator++(int) {
+                RouteIterator copy = *this;
+                ++position_;
+                return copy;
+            }
+
+            RouteIterator& operator--() {
+                --position_;
+                return *this;
+            }
+
+            RouteIterator operator--(int) {
+                RouteIterator copy = *this;
+                --position_;
+                return copy;
+            }
+
+            RouteIterator& operator+=(difference_type n) {
+                position_ += n;
+                return *this;
+            }
+
+            RouteIterator& operator-=(difference_type n) {
+                position_ -= n;
+                return *this;
+            }
+
+            RouteIterator operator+(difference_type n) const {
+                return RouteIterator(position_ + n, stops_);
+            }
+
+            friend RouteIterator operator+(difference_type n, const RouteIterator& it) {
+                return it + n;
+            }
+
+            RouteIterator operator-(difference_type n) const {
+                return RouteIterator(position_ - n, stops_);
+            }
+
+            difference_type operator-(const RouteIterator& other) const {
+                return position_ - other.position_;
+            }
+
+            bool operator==(const RouteIterator& other) const {
+                return position_ == other.position_;
+            }
+
+            bool operator!=(const RouteIterator& other) const {
+                return position_ != other.position_;
+            }
+
+            bool operator<(const RouteIterator& other) const {
+                return position_ < other.position_;
+            }
+
+            bool operator>(const RouteIterator& other) const {
+                return position_ > other.position_;
+            }
+
+            bool operator<=(const RouteIterator& other) const {
+                return position_ <= other.position_;
+            }
+
+            bool operator>=(const RouteIterator& other) const {
+                return position_ >= other.position_;
+            }
+
+        private:
+            const uint32_t* position_ = nullptr;
+            const stop_catalogue::StopColumns* stops_ = nullptr;
+        };
+
+        /*
+        * Остановки маршрута - отрезок общего столбца номеров остановок каталога автобусов.
+        * Действителен, пока в каталог не добавляются новые автобусы
+        */
+        class Route {
+        public:
+            Route(const uint32_t* begin, const uint32_t* end, const stop_catalogue::StopColumns* stops)
+                : begin_(begin, stops)
+                , end_(end, stops) {
+            }
+
+            RouteIterator begin() const {
+                return begin_;
+            }
+
+            RouteIterator end() const {
+                return end_;
+            }
+
+            std::reverse_iterator<RouteIterator> rbegin() const {
+                return std::reverse_iterator<RouteIterator>(end_);
+            }
+
+            std::reverse_iterator<RouteIterator> rend() const {
+                return std::reverse_iterator<RouteIterator>(begin_);
+            }
+
+            size_t size() const {
+                return static_cast<size_t>(end_ - begin_);
+            }
+
+            bool empty() const {
+                return begin_ == end_;
+            }
+
+            const stop_catalogue::Stop* front() const {
+                return *begin_;
+            }
+
+            const stop_catalogue::Stop* back() const {
+                return *(end_ - 1);
+            }
+
+        private:
+            RouteIterator begin_;
+            RouteIterator end_;
+        };
+
+        // Отрезок общего столбца номеров остановок
+        struct RouteSpan {
+            uint32_t offset = 0;
+            uint32_t size = 0;
+        };
+
+        struct BusColumns;
+
+        class Bus : public detail::Row {
+        public:
+            Bus(const BusColumns* columns, uint32_t row, uint32_t id)
+                : Row(row, id)
+                , columns_(columns) {
+            }
+
+            std::string_view GetName() const;
+
+            Route GetRoute() const;
+
+            RouteType GetRouteType() const;
+
+            double GetRouteGeoLength() const;
+
+            double GetRouteTrueLength() const;
+
+            uint32_t GetStopsOnRoute() const;
+
+            uint32_t GetUniqueStops() const;
+
+        private:
+            const BusColumns* columns_;
+        };
+
+        // Столбцы автобусов, строка - порядковый номер добавления автобуса
+        struct BusColumns {
+            std::deque<Bus> handles = {};
+            std::vector<std::string_view> names = {};
+            // Маршруты всех автобусов подряд, номерами строк остановок из stops
+            std::vector<uint32_t> route_stops = {};
+            const stop_catalogue::StopColumns* stops = nullptr;
+            std::vector<RouteSpan> routes = {};
+            std::vector<RouteType> route_types = {};
+            std::vector<double> route_geo_lengths = {};
+            std::vector<double> route_true_lengths = {};
+            std::vector<uint32_t> stops_on_route = {};
+            std::vector<uint32_t> unique_stops = {};
+        };
+
+        inline std::string_view Bus::GetName() const {
+            return columns_->names[GetRow()];
+        }
+
+        inline Route Bus::GetRoute() const {
+            const RouteSpan span = columns_->routes[GetRow()];
+            const uint32_t* begin = columns_->route_stops.data() + span.offset;
+            return Route(begin, begin + span.size, columns_->stops);
+        }
+
+        inline RouteType Bus::GetRouteType() const {
+            return columns_->route_types[GetRow()];
+        }
+
+        inline double Bus::GetRouteGeoLength() const {
+            return columns_->route_geo_lengths[GetRow()];
+        }
+
+        inline double Bus::GetRouteTrueLength() const {
+            return columns_->route_true_lengths[GetRow()];
+        }
+
+        inline uint32_t Bus::GetStopsOnRoute() const {
+            return columns_->stops_on_route[GetRow()];
+        }
+
+        inline uint32_t Bus::GetUniqueStops() const {
+            return columns_->unique_stops[GetRow()];
+        }
+
+        // Данные автобуса для добавления в каталог
+        struct BusData {
             std::string name = {};
-            std::deque<const stop_catalogue::Stop*> route = {};
+            std::vector<const stop_catalogue::Stop*> route = {};
             RouteType route_type = RouteType::Direct;
             double route_geo_length = 0.0;
             double route_true_length = 0.0;
-            size_t stops_on_route = 0;
-            size_t unique_stops = 0;
-            RouteSettings route_settings = {};
-
-            Bus() = default;
+            uint32_t stops_on_route = 0;
+            uint32_t unique_stops = 0;
         };
 
         class BusHelper {
@@ -198,30 +539,38 @@ namespace transport_catalogue {
                 return *this;
             }
 
-            BusHelper& SetRouteSettings(RouteSettings settings) {
-                settings_ = std::move(settings);
+            // Задаёт маршрут уже найденными остановками, минуя поиск по именам
+            BusHelper& SetRoute(std::vector<const stop_catalogue::Stop*>&& route) {
+                route_ = std::move(route);
                 return *this;
             }
 
-            Bus Build(const stop_catalogue::Catalogue& stops_catalogue);
+            BusData Build(const stop_catalogue::Catalogue& stops_catalogue);
 
         private:
-            double CalcRouteGeoLength(const std::deque<const stop_catalogue::Stop*>& route, RouteType route_type) const;
-            double CalcRouteTrueLength(const std::deque<const stop_catalogue::Stop*>& route, const stop_catalogue::DistancesContainer& stops_distances, RouteType route_type) const;
+            double CalcRouteGeoLength(const std::vector<const stop_catalogue::Stop*>& route, RouteType route_type) const;
+            double CalcRouteTrueLength(const std::vector<const stop_catalogue::Stop*>& route, const stop_catalogue::DistancesContainer& stops_distances, RouteType route_type) const;
 
         private:
             std::string name_;
             RouteType route_type_;
             std::vector<std::string_view> stop_names_;
-            RouteSettings settings_;
+            std::vector<const stop_catalogue::Stop*> route_;
         };
 
         std::ostream& operator<< (std::ostream& out, const Bus& bus);
 
-        class Catalogue : public detail::CatalogueTemplate<Bus> {
+        class Catalogue : public detail::CatalogueTemplate<Bus, BusColumns> {
         public:
             Catalogue() = default;
 
+            // Остановки маршрута должны принадлежать каталогу stops
+            const Bus* Push(BusData&& data, const stop_catalogue::Catalogue& stops);
+
+            const Bus* Push(size_t id, BusData&& data, const stop_catalogue::Catalogue& stops);
+
+            void Reserve(size_t bus_count, size_t route_stop_count);
+
             void SetRouteSettings(RouteSettings&& settings) {
                 settings_ = std::move(settings);
             }
@@ -230,6 +579,9 @@ namespace transport_catalogue {
                 return settings_;
             }
 
+        private:
+            void PushColumns(BusData&& data, const stop_catalogue::Catalogue& stops);
+
         private:
             RouteSettings settings_ = {};
         };
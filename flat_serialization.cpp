@@ -0,0 +1,643 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "flat_serialization.h"
+#include "sectioned_file.h"
+#include "serialization.h"
+
+namespace flat_serialization {
+
+    namespace {
+
+        constexpr sectioned_file::Signature SIGNATURE = { 'T', 'C', 'F', 'L', 'A', 'T', '\0', '\0' };
+        constexpr uint32_t VERSION = 1;
+
+        // Отсутствующий номер (автобус у ребра ожидания, ребро в начале маршрута)
+        constexpr uint32_t NO_ID = std::numeric_limits<uint32_t>::max();
+
+        enum class SectionKind : uint32_t {
+            STRINGS = 1,
+            STOPS,
+            BUSES,
+            BUS_ROUTES,
+            SETTINGS,
+            GRAPH_EDGES,
+            GRAPH_INCIDENCE_OFFSETS,
+            GRAPH_INCIDENCE_EDGES,
+            GRAPH_EDGE_DATA,
+            GRAPH_STOP_VERTICES,
+            ROUTER_ROW_OFFSETS,
+            ROUTER_CELLS,
+            MAP_FINGERPRINT,
+            MAP_SVG,
+            ROUTING_FINGERPRINT
+        };
+        constexpr uint32_t SECTION_COUNT = static_cast<uint32_t>(SectionKind::ROUTING_FINGERPRINT);
+
+        // Разделы, по которым отрисовывается карта
+        constexpr SectionKind MAP_SOURCE_SECTIONS[] = {
+            SectionKind::STRINGS, SectionKind::STOPS, SectionKind::BUSES, SectionKind::BUS_ROUTES, SectionKind::SETTINGS };
+
+        // Положение имени в разделе STRINGS
+        struct FlatName {
+            uint32_t offset;
+            uint32_t size;
+        };
+
+        struct FlatStop {
+            uint32_t id;
+            FlatName name;
+            uint32_t reserved;
+            double lat;
+            double lng;
+        };
+
+        // Остановки маршрута занимают [route_offset, route_offset + route_size) в разделе BUS_ROUTES
+        struct FlatBus {
+            uint32_t id;
+            FlatName name;
+            uint32_t route_type;
+            uint32_t route_offset;
+            uint32_t route_size;
+            uint32_t stops_on_route;
+            uint32_t unique_stops;
+            double route_geo_length;
+            double route_true_length;
+        };
+
+        struct FlatEdge {
+            uint32_t from;
+            uint32_t to;
+            double weight;
+        };
+
+        struct FlatEdgeData {
+            uint32_t edge_id;
+            uint32_t stop_from_id;
+            uint32_t stop_to_id;
+            uint32_t bus_id;
+            int32_t stop_count;
+            uint32_t reserved;
+            double time;
+        };
+
+        struct FlatStopVertex {
+            uint32_t stop_id;
+            uint32_t id;
+            uint32_t transfer_id;
+            uint32_t reserved;
+        };
+
+        // Достижимая ячейка pos строки матрицы маршрутов
+        struct FlatRouteCell {
+            uint32_t pos;
+            uint32_t prev_edge;
+            double weight;
+        };
+
+        static_assert(sizeof(FlatStop) == 32 && sizeof(FlatBus) == 48 && sizeof(FlatEdge) == 16);
+        static_assert(sizeof(FlatEdgeData) == 32 && sizeof(FlatStopVertex) == 16 && sizeof(FlatRouteCell) == 16);
+
+        [[noreturn]] void ThrowCorrupted(const std::string& what) {
+            throw std::logic_error("Corrupted flat base file: " + what);
+        }
+
+        // ---------- BaseWriter ------------------------------------------------------
+
+        // Небольшие разделы накапливаются в памяти и сбрасываются в файл перед потоковым
+        // разделом или в Finish. Большие разделы пишутся в файл сразу через BeginSection
+        class BaseWriter {
+        public:
+            explicit BaseWriter(std::ostream& out)
+                : file_(out, SIGNATURE, VERSION, SECTION_COUNT) {
+            }
+
+            template <typename Record>
+            void Append(SectionKind kind, const Record& record) {
+                static_assert(std::is_trivially_copyable_v<Record>);
+                Section(kind).append(reinterpret_cast<const char*>(&record), sizeof(Record));
+            }
+
+            void AppendBytes(SectionKind kind, std::string_view bytes) {
+                Section(kind).append(bytes);
+            }
+
+            FlatName AddName(std::string_view name) {
+                std::string& strings = Section(SectionKind::STRINGS);
+                const FlatName result{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(name.size()) };
+                strings.append(name);
+                return result;
+            }
+
+            // Метод возвращает накапливаемый раздел kind, создавая пустой раздел при первом обращении
+            std::string& Section(SectionKind kind) {
+                for (auto& [section_kind, bytes] : sections_) {
+                    if (section_kind == kind) {
+                        return bytes;
+                    }
+                }
+                return sections_.emplace_back(kind, std::string{}).second;
+            }
+
+            std::ostream& BeginSection(SectionKind kind) {
+                Flush();
+                return file_.BeginSection(static_cast<uint32_t>(kind));
+            }
+
+            void Finish() {
+                Flush();
+                file_.Finish();
+            }
+
+        private:
+            void Flush() {
+                for (const auto& [kind, bytes] : sections_) {
+                    file_.WriteSection(static_cast<uint32_t>(kind), bytes);
+                }
+                sections_.clear();
+            }
+
+        private:
+            sectioned_file::Writer file_;
+            std::vector<std::pair<SectionKind, std::string>> sections_;
+        };
+
+        // ---------- BaseReader ------------------------------------------------------
+
+        // Массив записей раздела. Записи копируются при чтении, поэтому
+        // выравнивание данных в памяти не требуется
+        template <typename Record>
+        class RecordsView {
+        public:
+            explicit RecordsView(std::string_view bytes)
+                : bytes_(bytes) {
+                static_assert(std::is_trivially_copyable_v<Record>);
+                if (bytes.size() % sizeof(Record) != 0) {
+                    ThrowCorrupted("section size is not a multiple of its record size");
+                }
+            }
+
+            size_t Size() const {
+                return bytes_.size() / sizeof(Record);
+            }
+
+            Record operator[] (size_t index) const {
+                Record record;
+                std::memcpy(&record, bytes_.data() + index * sizeof(Record), sizeof(Record));
+                return record;
+            }
+
+        private:
+            std::string_view bytes_;
+        };
+
+        class BaseReader {
+        public:
+            explicit BaseReader(const std::string& file)
+                : file_(file, SIGNATURE, VERSION) {
+            }
+
+            bool Has(SectionKind kind) const {
+                return file_.Has(static_cast<uint32_t>(kind));
+            }
+
+            std::string_view Section(SectionKind kind) const {
+                return file_.Section(static_cast<uint32_t>(kind));
+            }
+
+            template <typename Record>
+            RecordsView<Record> Records(SectionKind kind) const {
+                return RecordsView<Record>(Section(kind));
+            }
+
+            std::string_view Name(FlatName name) const {
+                const std::string_view strings = Section(SectionKind::STRINGS);
+                if (name.offset > strings.size() || name.size > strings.size() - name.offset) {
+                    ThrowCorrupted("name is out of string section bounds");
+                }
+                return strings.substr(name.offset, name.size);
+            }
+
+        private:
+            sectioned_file::Reader file_;
+        };
+
+        // Отпечаток карты зависит от разделов каталога и настроек и от версии отрисовки
+        template <typename GetSection>
+        uint64_t MapFingerprint(GetSection get_section) {
+            uint64_t fingerprint = sectioned_file::Fingerprint(std::to_string(map_renderer::RENDER_VERSION));
+            for (SectionKind kind : MAP_SOURCE_SECTIONS) {
+                const std::string_view bytes = get_section(kind);
+                const uint64_t size = bytes.size();
+                // Размер разделяет соседние разделы, чтобы перенос байт между ними менял отпечаток
+                fingerprint = sectioned_file::Fingerprint(std::string_view(reinterpret_cast<const char*>(&size), sizeof(size)), fingerprint);
+                fingerprint = sectioned_file::Fingerprint(bytes, fingerprint);
+            }
+            return fingerprint;
+        }
+
+        // Функция проверяет, что смещения CSR не убывают и не выходят за count
+        template <typename Offset>
+        void CheckOffsets(const RecordsView<Offset>& offsets, size_t count) {
+            if (offsets.Size() == 0 || offsets[0] != 0 || offsets[offsets.Size() - 1] != count) {
+                ThrowCorrupted("wrong offsets");
+            }
+            for (size_t i = 1; i < offsets.Size(); ++i) {
+                if (offsets[i] < offsets[i - 1]) {
+                    ThrowCorrupted("wrong offsets");
+                }
+            }
+        }
+
+        // ---------- Serialization ---------------------------------------------------
+
+        void WriteGraph(BaseWriter& writer, const transport_graph::TransportGraph& graph, const request_handler::RequestHandler& rh) {
+            graph::GraphSerialization<transport_graph::TransportTime> gs;
+
+            for (const auto& edge : gs.GetEdges(graph.GetGraph())) {
+                writer.Append(SectionKind::GRAPH_EDGES,
+                    FlatEdge{ static_cast<uint32_t>(edge.from), static_cast<uint32_t>(edge.to), edge.weight });
+            }
+
+            uint64_t offset = 0;
+            writer.Append(SectionKind::GRAPH_INCIDENCE_OFFSETS, offset);
+            for (const auto& incidence_list : gs.GetIncidenceList(graph.GetGraph())) {
+                for (graph::EdgeId edge_id : incidence_list) {
+                    writer.Append(SectionKind::GRAPH_INCIDENCE_EDGES, static_cast<uint32_t>(edge_id));
+                }
+                offset += incidence_list.size();
+                writer.Append(SectionKind::GRAPH_INCIDENCE_OFFSETS, offset);
+            }
+
+            // Записи идут по номерам рёбер и остановок, а не в порядке хеш-таблиц графа: иначе
+            // база с переиспользованным графом отличалась бы от собранной заново
+            const auto& edge_id_to_graph_data = graph.GetEdgeIdToGraphData();
+            for (graph::EdgeId edge_id = 0; edge_id < graph.GetGraph().GetEdgeCount(); ++edge_id) {
+                const transport_graph::TransportGraphData& data = edge_id_to_graph_data.at(edge_id);
+                FlatEdgeData record{};
+                record.edge_id = static_cast<uint32_t>(edge_id);
+                record.stop_from_id = static_cast<uint32_t>(rh.GetId(data.from));
+                record.stop_to_id = static_cast<uint32_t>(rh.GetId(data.to));
+                record.bus_id = data.bus ? static_cast<uint32_t>(rh.GetId(data.bus)) : NO_ID;
+                record.stop_count = data.stop_count;
+                record.time = data.time;
+                writer.Append(SectionKind::GRAPH_EDGE_DATA, record);
+            }
+
+            std::vector<FlatStopVertex> stop_vertices;
+            stop_vertices.reserve(graph.GetStopToVertexId().size());
+            for (const auto& [stop, vertex_id] : graph.GetStopToVertexId()) {
+                FlatStopVertex record{};
+                record.stop_id = static_cast<uint32_t>(rh.GetId(stop));
+                record.id = static_cast<uint32_t>(vertex_id.id);
+                record.transfer_id = static_cast<uint32_t>(vertex_id.transfer_id);
+                stop_vertices.push_back(record);
+            }
+            std::sort(stop_vertices.begin(), stop_vertices.end(), [](const FlatStopVertex& lhs, const FlatStopVertex& rhs) {
+                return lhs.stop_id < rhs.stop_id;
+            });
+            for (const FlatStopVertex& record : stop_vertices) {
+                writer.Append(SectionKind::GRAPH_STOP_VERTICES, record);
+            }
+        }
+
+        // Ячейки роутера пишутся в файл по мере обхода матрицы, смещения строк накапливаются в памяти
+        void WriteRouter(BaseWriter& writer, const transport_graph::TransportRouter& transport_router) {
+            const auto& router = transport_graph::TransportRouterGetter::GetRouter(transport_router);
+
+            std::ostream& cells = writer.BeginSection(SectionKind::ROUTER_CELLS);
+            uint64_t offset = 0;
+            writer.Append(SectionKind::ROUTER_ROW_OFFSETS, offset);
+            for (const auto& row : graph::RouterDataGetter<transport_graph::TransportTime>::GetInternalData(router)) {
+                for (size_t pos = 0; pos < row.size(); ++pos) {
+                    if (row[pos]) {
+                        const uint32_t prev_edge = row[pos]->prev_edge ? static_cast<uint32_t>(*row[pos]->prev_edge) : NO_ID;
+                        const FlatRouteCell cell{ static_cast<uint32_t>(pos), prev_edge, row[pos]->weight };
+                        cells.write(reinterpret_cast<const char*>(&cell), sizeof(cell));
+                        ++offset;
+                    }
+                }
+                writer.Append(SectionKind::ROUTER_ROW_OFFSETS, offset);
+            }
+        }
+
+        // ---------- Deserialization -------------------------------------------------
+
+        const transport_catalogue::stop_catalogue::Stop* GetStop(const request_handler::RequestHandler& rh, uint32_t id) {
+            const auto* stop = rh.GetStopById(id);
+            if (!stop) {
+                ThrowCorrupted("unknown stop id " + std::to_string(id));
+            }
+            return stop;
+        }
+
+        void ReadCatalogue(const BaseReader& reader, request_handler::RequestHandler& rh) {
+            const auto stops = reader.Records<FlatStop>(SectionKind::STOPS);
+            for (size_t i = 0; i < stops.Size(); ++i) {
+                const FlatStop record = stops[i];
+                rh.AddStop(record.id, std::string(reader.Name(record.name)), Coordinates{ record.lat, record.lng });
+            }
+
+            const auto routes = reader.Records<uint32_t>(SectionKind::BUS_ROUTES);
+            const auto buses = reader.Records<FlatBus>(SectionKind::BUSES);
+            for (size_t i = 0; i < buses.Size(); ++i) {
+                const FlatBus record = buses[i];
+                if (record.route_offset > routes.Size() || record.route_size > routes.Size() - record.route_offset) {
+                    ThrowCorrupted("bus route is out of section bounds");
+                }
+
+                transport_catalogue::bus_catalogue::BusData bus;
+                bus.name = std::string(reader.Name(record.name));
+                bus.route.reserve(record.route_size);
+                for (uint32_t j = 0; j < record.route_size; ++j) {
+                    bus.route.push_back(GetStop(rh, routes[record.route_offset + j]));
+                }
+                bus.route_type = transport_catalogue::RouteTypeFromInt(record.route_type);
+                bus.route_geo_length = record.route_geo_length;
+                bus.route_true_length = record.route_true_length;
+                bus.stops_on_route = record.stops_on_route;
+                bus.unique_stops = record.unique_stops;
+                rh.AddBus(record.id, std::move(bus));
+            }
+        }
+
+        void ReadSettings(const BaseReader& reader, request_handler::RequestHandler& rh) {
+            using namespace transport_serialization::detail_deserialization;
+
+            const std::string_view bytes = reader.Section(SectionKind::SETTINGS);
+            transport_proto::TransportCatalogue settings;
+            if (!settings.ParseFromArray(bytes.data(), static_cast<int>(bytes.size()))) {
+                ThrowCorrupted("wrong settings section");
+            }
+
+            rh.SetMapRenderSettings(CreateMapRenderSettings(settings.map_render_setting()));
+            rh.SetRouteSettings(CreateRouteSettings(settings.route_settings()));
+        }
+
+        transport_graph::TransportGraph ReadGraph(const BaseReader& reader, const request_handler::RequestHandler& rh) {
+            using namespace transport_graph;
+
+            const auto offsets = reader.Records<uint64_t>(SectionKind::GRAPH_INCIDENCE_OFFSETS);
+            const auto incidence_edges = reader.Records<uint32_t>(SectionKind::GRAPH_INCIDENCE_EDGES);
+            CheckOffsets(offsets, incidence_edges.Size());
+            const size_t vertex_count = offsets.Size() - 1;
+
+            const auto flat_edges = reader.Records<FlatEdge>(SectionKind::GRAPH_EDGES);
+            const size_t edge_count = flat_edges.Size();
+            std::vector<graph::Edge<TransportTime>> edges;
+            edges.reserve(edge_count);
+            for (size_t i = 0; i < edge_count; ++i) {
+                const FlatEdge record = flat_edges[i];
+                if (record.from >= vertex_count || record.to >= vertex_count) {
+                    ThrowCorrupted("edge vertex is out of graph bounds");
+                }
+                edges.push_back({ record.from, record.to, record.weight });
+            }
+
+            std::vector<graph::DirectedWeightedGraph<TransportTime>::IncidenceList> incidence_lists(vertex_count);
+            for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+                auto& list = incidence_lists[vertex];
+                list.reserve(static_cast<size_t>(offsets[vertex + 1] - offsets[vertex]));
+                for (size_t i = static_cast<size_t>(offsets[vertex]); i < offsets[vertex + 1]; ++i) {
+                    if (incidence_edges[i] >= edge_count) {
+                        ThrowCorrupted("incident edge is out of graph bounds");
+                    }
+                    list.push_back(incidence_edges[i]);
+                }
+            }
+
+            // Маршрут восстанавливается по данным каждого своего ребра, поэтому они должны быть у всех рёбер
+            const auto edge_data = reader.Records<FlatEdgeData>(SectionKind::GRAPH_EDGE_DATA);
+            if (edge_data.Size() != edge_count) {
+                ThrowCorrupted("edge data count differs from edge count");
+            }
+            std::unordered_map<graph::EdgeId, TransportGraphData> edge_id_to_graph_data;
+            edge_id_to_graph_data.reserve(edge_count);
+            for (size_t i = 0; i < edge_data.Size(); ++i) {
+                const FlatEdgeData record = edge_data[i];
+                if (record.edge_id >= edge_count) {
+                    ThrowCorrupted("edge data is out of graph bounds");
+                }
+                if (record.time != edges[record.edge_id].weight) {
+                    ThrowCorrupted("edge data time differs from edge weight");
+                }
+                TransportGraphData data{};
+                data.from = GetStop(rh, record.stop_from_id);
+                data.to = GetStop(rh, record.stop_to_id);
+                if (record.bus_id != NO_ID) {
+                    data.bus = rh.GetBusById(record.bus_id);
+                    if (!data.bus) {
+                        ThrowCorrupted("unknown bus id " + std::to_string(record.bus_id));
+                    }
+                }
+                data.stop_count = record.stop_count;
+                data.time = record.time;
+                if (!edge_id_to_graph_data.emplace(record.edge_id, data).second) {
+                    ThrowCorrupted("duplicate edge data");
+                }
+            }
+
+            const auto stop_vertices = reader.Records<FlatStopVertex>(SectionKind::GRAPH_STOP_VERTICES);
+            std::unordered_map<const stop_catalogue::Stop*, VertexIdLoop> stop_to_vertex_id;
+            stop_to_vertex_id.reserve(stop_vertices.Size());
+            for (size_t i = 0; i < stop_vertices.Size(); ++i) {
+                const FlatStopVertex record = stop_vertices[i];
+                if (record.id >= vertex_count || record.transfer_id >= vertex_count) {
+                    ThrowCorrupted("stop vertex is out of graph bounds");
+                }
+                stop_to_vertex_id.emplace(GetStop(rh, record.stop_id), VertexIdLoop{ record.id, record.transfer_id });
+            }
+
+            TransportGraphDeserialization deserializer;
+
+            deserializer.CreateGraph(std::move(edges), std::move(incidence_lists));
+            deserializer.SetEdgeIdToGraphData(std::move(edge_id_to_graph_data));
+            deserializer.SetStopToVertexId(std::move(stop_to_vertex_id));
+
+            return deserializer.Build();
+        }
+
+        transport_serialization::detail_deserialization::RoutesInternalData ReadRoutesInternalData(const BaseReader& reader) {
+            using namespace transport_serialization::detail_deserialization;
+            using RouterType = graph::Router<transport_graph::TransportTime>;
+
+            const auto offsets = reader.Records<uint64_t>(SectionKind::ROUTER_ROW_OFFSETS);
+            const auto cells = reader.Records<FlatRouteCell>(SectionKind::ROUTER_CELLS);
+            CheckOffsets(offsets, cells.Size());
+
+            // Граф читается параллельно, поэтому его размеры берутся из размеров его разделов
+            const size_t vertex_count = offsets.Size() - 1;
+            const size_t edge_count = reader.Records<FlatEdge>(SectionKind::GRAPH_EDGES).Size();
+            if (vertex_count + 1 != reader.Records<uint64_t>(SectionKind::GRAPH_INCIDENCE_OFFSETS).Size()) {
+                ThrowCorrupted("router size differs from graph size");
+            }
+
+            return DecodeRoutesInternalData(vertex_count, [&offsets, &cells, vertex_count, edge_count](size_t from) {
+                RoutesInternalDataRow row(vertex_count);
+                for (size_t i = static_cast<size_t>(offsets[from]); i < offsets[from + 1]; ++i) {
+                    const FlatRouteCell cell = cells[i];
+                    if (cell.pos >= vertex_count) {
+                        ThrowCorrupted("route cell is out of matrix bounds");
+                    }
+                    if (cell.prev_edge != NO_ID && cell.prev_edge >= edge_count) {
+                        ThrowCorrupted("route cell edge is out of graph bounds");
+                    }
+                    row[cell.pos] = RouterType::RouteInternalData{
+                        cell.weight,
+                        cell.prev_edge != NO_ID ? std::optional<graph::EdgeId>(cell.prev_edge) : std::nullopt };
+                }
+                return row;
+            });
+        }
+
+    } // namespace
+
+    bool IsFlatBase(const std::string& file) {
+        return sectioned_file::HasSignature(file, SIGNATURE);
+    }
+
+    void Serialize(std::ofstream& out, const request_handler::RequestHandler& rh) {
+        using namespace transport_serialization::detail_serialization;
+
+        BaseWriter writer(out);
+
+        for (const transport_catalogue::stop_catalogue::Stop* stop : rh.GetStops()) {
+            FlatStop record{};
+            record.id = static_cast<uint32_t>(rh.GetId(stop));
+            record.name = writer.AddName(stop->GetName());
+            record.lat = stop->GetCoordinates().lat;
+            record.lng = stop->GetCoordinates().lng;
+            writer.Append(SectionKind::STOPS, record);
+        }
+
+        uint32_t route_offset = 0;
+        for (const transport_catalogue::bus_catalogue::Bus* bus : rh.GetBuses()) {
+            FlatBus record{};
+            record.id = static_cast<uint32_t>(rh.GetId(bus));
+            const auto route = bus->GetRoute();
+            record.name = writer.AddName(bus->GetName());
+            record.route_type = static_cast<uint32_t>(bus->GetRouteType());
+            record.route_offset = route_offset;
+            record.route_size = static_cast<uint32_t>(route.size());
+            record.stops_on_route = bus->GetStopsOnRoute();
+            record.unique_stops = bus->GetUniqueStops();
+            record.route_geo_length = bus->GetRouteGeoLength();
+            record.route_true_length = bus->GetRouteTrueLength();
+            writer.Append(SectionKind::BUSES, record);
+
+            for (const auto* stop : route) {
+                writer.Append(SectionKind::BUS_ROUTES, static_cast<uint32_t>(rh.GetId(stop)));
+            }
+            route_offset += record.route_size;
+        }
+
+        transport_proto::TransportCatalogue settings;
+        if (const auto& map_render_settings = rh.GetMapRenderSettings()) {
+            *settings.mutable_map_render_setting() = CreateProtoMapRenderSettings(*map_render_settings);
+        }
+        *settings.mutable_route_settings() = CreateProtoRouteSetting(rh.GetRouteSettings());
+        writer.AppendBytes(SectionKind::SETTINGS, settings.SerializeAsString());
+
+        if (rh.GetGraph()) {
+            WriteGraph(writer, *rh.GetGraph(), rh);
+        }
+
+        // Карта отрисовывается один раз при создании базы, а не при каждом запуске process_requests.
+        // Отпечаток считается до записи роутера, пока разделы каталога ещё в памяти
+        if (rh.GetMapRenderSettings() && rh.GetEscapedMap()) {
+            writer.Append(SectionKind::MAP_FINGERPRINT, MapFingerprint([&writer](SectionKind kind) -> std::string_view {
+                return writer.Section(kind);
+            }));
+            writer.AppendBytes(SectionKind::MAP_SVG, *rh.GetEscapedMap());
+        }
+
+        if (rh.GetRouter()) {
+            // По отпечатку следующий make_base решает, можно ли взять граф и роутер из этой базы
+            writer.Append(SectionKind::ROUTING_FINGERPRINT, rh.GetRoutingFingerprint());
+            WriteRouter(writer, *rh.GetRouter());
+        }
+
+        writer.Finish();
+    }
+
+    void Deserialize(request_handler::RequestHandler& rh, const std::string& file) {
+        // Читатель разделяется с отложенными загрузчиками графа и роутера и держит файл отображённым до их вызова
+        auto reader = std::make_shared<const BaseReader>(file);
+
+        ReadCatalogue(*reader, rh);
+        ReadSettings(*reader, rh);
+
+        if (reader->Has(SectionKind::MAP_FINGERPRINT)) {
+            rh.SetMapLoader([reader]() -> std::optional<std::string> {
+                const auto fingerprint = reader->Records<uint64_t>(SectionKind::MAP_FINGERPRINT);
+                const uint64_t expected = MapFingerprint([&reader](SectionKind kind) {
+                    return reader->Section(kind);
+                });
+                if (fingerprint.Size() != 1 || fingerprint[0] != expected) {
+                    return std::nullopt;
+                }
+                return std::string(reader->Section(SectionKind::MAP_SVG));
+            });
+        }
+
+        if (!reader->Has(SectionKind::GRAPH_INCIDENCE_OFFSETS)) {
+            if (reader->Has(SectionKind::ROUTER_ROW_OFFSETS)) {
+                ThrowCorrupted("router without graph");
+            }
+            return;
+        }
+
+        request_handler::RequestHandler::RoutesLoader routes_loader;
+        if (reader->Has(SectionKind::ROUTER_ROW_OFFSETS)) {
+            routes_loader = [reader] {
+                return ReadRoutesInternalData(*reader);
+            };
+        }
+        rh.SetRouterLoaders(
+            [reader, &rh] {
+                return ReadGraph(*reader, rh);
+            },
+            std::move(routes_loader));
+    }
+
+    bool ReuseRouter(request_handler::RequestHandler& rh, const std::string& file) {
+        if (!IsFlatBase(file)) {
+            return false;
+        }
+
+        // Прежняя база лишь ускоряет построение, поэтому любая её ошибка означает полное построение
+        try {
+            const BaseReader reader(file);
+            if (!reader.Has(SectionKind::GRAPH_INCIDENCE_OFFSETS) || !reader.Has(SectionKind::ROUTER_ROW_OFFSETS)) {
+                return false;
+            }
+            const auto fingerprint = reader.Records<uint64_t>(SectionKind::ROUTING_FINGERPRINT);
+            if (fingerprint.Size() != 1 || fingerprint[0] != rh.GetRoutingFingerprint()) {
+                return false;
+            }
+
+            auto graph = std::make_unique<transport_graph::TransportGraph>(ReadGraph(reader, rh));
+            auto router = transport_graph::TransportRouterCreator::Build(
+                *graph,
+                graph::RouterCreator<transport_graph::TransportTime>::Build(graph->GetGraph(), ReadRoutesInternalData(reader)));
+
+            // Граф и роутер передаются вместе только после того, как оба собраны без ошибок
+            rh.SetRouter(std::move(graph), std::move(router));
+            return true;
+        }
+        catch (const std::logic_error&) {
+            return false;
+        }
+    }
+
+} // namespace flat_serialization
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+#include "request_handler.h"
+
+/*
+* Плоский двоичный формат базы - файл из разделов (см. sectioned_file.h).
+* Каждый раздел - массив записей фиксированного размера:
+* строки имён, остановки, автобусы, остановки маршрутов, рёбра графа, списки
+* инцидентности в формате CSR, данные рёбер, вершины остановок и достижимые ячейки
+* матрицы маршрутов, также в формате CSR по строкам. Настройки карты и маршрутов
+* хранятся в отдельном разделе как сообщение protobuf.
+* Файл отображается в память и читается без разбора: записи копируются напрямую.
+* Граф и роутер загружаются при первом запросе маршрута. Карта, отрисованная при
+* создании базы, хранится вместе с отпечатком разделов, по которым она построена
+*/
+namespace flat_serialization {
+
+    // Функция проверяет по сигнатуре, записан ли файл в плоском формате
+    bool IsFlatBase(const std::string& file);
+
+    void Serialize(std::ofstream& out, const request_handler::RequestHandler& request_handler);
+
+    // При повреждённом или несовместимом файле бросает std::logic_error
+    void Deserialize(request_handler::RequestHandler& request_handler, const std::string& file);
+
+    // Аналог transport_serialization::ReuseRouter для базы в плоском формате
+    bool ReuseRouter(request_handler::RequestHandler& request_handler, const std::string& file);
+
+} // namespace flat_serialization
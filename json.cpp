@@ -1,9 +1,119 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <map>
 #include <utility>
 
 #include "json.h"
 
 namespace json {
 
+    // ---------- Dict ------------------------------------------------------------
+
+    namespace {
+
+        struct KeyLess {
+            bool operator() (const Dict::value_type& item, std::string_view key) const {
+                return item.first < key;
+            }
+        };
+
+    } // namespace
+
+    Dict::Dict(std::initializer_list<value_type> items) {
+        items_.reserve(items.size());
+        for (const value_type& item : items) {
+            insert(value_type(item));
+        }
+    }
+
+    std::pair<Dict::iterator, bool> Dict::insert(value_type&& item) {
+        auto it = std::lower_bound(items_.begin(), items_.end(), item.first, KeyLess{});
+        if (it != items_.end() && it->first == item.first) {
+            return { it, false };
+        }
+        return { items_.insert(it, std::move(item)), true };
+    }
+
+    void Dict::AppendUnsorted(value_type&& item) {
+        items_.push_back(std::move(item));
+    }
+
+    void Dict::SortUnique() {
+        std::stable_sort(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) {
+            return lhs.first < rhs.first;
+        });
+        items_.erase(std::unique(items_.begin(), items_.end(), [](const value_type& lhs, const value_type& rhs) {
+            return lhs.first == rhs.first;
+        }), items_.end());
+    }
+
+    Dict::iterator Dict::find(std::string_view key) {
+        auto it = std::lower_bound(items_.begin(), items_.end(), key, KeyLess{});
+        return (it != items_.end() && it->first == key) ? it : items_.end();
+    }
+
+    Dict::const_iterator Dict::find(std::string_view key) const {
+        auto it = std::lower_bound(items_.begin(), items_.end(), key, KeyLess{});
+        return (it != items_.end() && it->first == key) ? it : items_.end();
+    }
+
+    size_t Dict::count(std::string_view key) const {
+        return (find(key) != end()) ? 1 : 0;
+    }
+
+    Node& Dict::at(std::string_view key) {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Dict has no key \"" + std::string(key) + "\"");
+        }
+        return it->second;
+    }
+
+    const Node& Dict::at(std::string_view key) const {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("Dict has no key \"" + std::string(key) + "\"");
+        }
+        return it->second;
+    }
+
+    void Dict::reserve(size_t count) {
+        items_.reserve(count);
+    }
+
+    size_t Dict::size() const {
+        return items_.size();
+    }
+
+    bool Dict::empty() const {
+        return items_.empty();
+    }
+
+    Dict::iterator Dict::begin() {
+        return items_.begin();
+    }
+
+    Dict::iterator Dict::end() {
+        return items_.end();
+    }
+
+    Dict::const_iterator Dict::begin() const {
+        return items_.begin();
+    }
+
+    Dict::const_iterator Dict::end() const {
+        return items_.end();
+    }
+
+    bool operator== (const Dict& lhs, const Dict& rhs) {
+        return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+    }
+
+    bool operator!= (const Dict& lhs, const Dict& rhs) {
+        return !(lhs == rhs);
+    }
+
     // ---------- NodePrinter -----------------------------------------------------
 
     void NodePrinter::operator() (std::nullptr_t) const {
@@ -12,7 +122,7 @@ namespace json {
         out << "null"sv;
     }
 
-    void NodePrinter::operator() (const std::string& value) const {
+    void NodePrinter::operator() (std::string_view value) const {
         using namespace std::literals;
 
         static const std::map<char, std::string> escapes = {
@@ -36,18 +146,29 @@ namespace json {
     }
 
     void NodePrinter::operator() (bool value) const {
+        using namespace std::literals;
         helper.PrintIndent();
-        out << std::boolalpha << value;
+        out << (value ? "true"sv : "false"sv);
     }
 
     void NodePrinter::operator() (int value) const {
         helper.PrintIndent();
-        out << value;
+        std::array<char, 16> buffer;
+        auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+        out.write(buffer.data(), end - buffer.data());
     }
 
     void NodePrinter::operator() (double value) const {
         helper.PrintIndent();
-        out << value;
+        // Формат general с точностью потока даёт тот же результат, что и operator<<
+        std::array<char, 32> buffer;
+        auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value,
+            std::chars_format::general, static_cast<int>(out.precision()));
+        if (ec != std::errc{}) {
+            out << value;
+            return;
+        }
+        out.write(buffer.data(), end - buffer.data());
     }
 
     void NodePrinter::operator() (const Array& value) const {
@@ -82,7 +203,10 @@ namespace json {
 
     // ---------- Node ------------------------------------------------------------
 
-    const std::string& Node::AsString() const {
+    std::string_view Node::AsString() const {
+        if (const auto* value = std::get_if<std::string_view>(&Data())) {
+            return *value;
+        }
         if (!IsString()) {
             throw std::logic_error("Node data is not string format");
         }
@@ -128,13 +252,6 @@ namespace json {
         return AsMap();
     }
 
-    std::string& Node::AsString() {
-        if (!IsString()) {
-            throw std::logic_error("Node data is not string format");
-        }
-        return std::get<std::string>(Data());
-    }
-
     Array& Node::AsArray() {
         if (!IsArray()) {
             throw std::logic_error("Node data is not Array format");
@@ -158,7 +275,7 @@ namespace json {
     }
 
     bool Node::IsString() const {
-        return std::holds_alternative<std::string>(Data());
+        return std::holds_alternative<std::string>(Data()) || std::holds_alternative<std::string_view>(Data());
     }
 
     bool Node::IsBool() const {
@@ -198,6 +315,10 @@ namespace json {
     }
 
     bool operator== (const Node& lhs, const Node& rhs) {
+        // Строки сравниваются по содержимому независимо от способа хранения
+        if (lhs.IsString() && rhs.IsString()) {
+            return lhs.AsString() == rhs.AsString();
+        }
         return lhs.Data() == rhs.Data();
     }
 
@@ -1,9 +1,11 @@
 #pragma once
 
+#include <initializer_list>
 #include <istream>
-#include <map>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <variant>
 #include <vector>
 
@@ -17,10 +19,61 @@ namespace json {
         using runtime_error::runtime_error;
     };
 
-        class Node;
-    using Dict = std::map<std::string, Node>;
+    class Node;
     using Array = std::vector<Node>;
 
+    // ---------- Dict ------------------------------------------------------------
+
+    /*
+    * Словарь JSON на основе отсортированного по ключу вектора пар.
+    * Элементы хранятся непрерывно, порядок обхода совпадает с std::map,
+    * поиск принимает std::string_view и не создаёт временных строк
+    */
+    class Dict {
+    public:
+        using value_type = std::pair<std::string, Node>;
+        using Container = std::vector<value_type>;
+        using iterator = Container::iterator;
+        using const_iterator = Container::const_iterator;
+
+        Dict() = default;
+        Dict(std::initializer_list<value_type> items);
+
+        // Как и std::map::insert, не заменяет значение уже существующего ключа
+        std::pair<iterator, bool> insert(value_type&& item);
+
+        // Добавляет пару в конец без упорядочивания. Парсер так собирает объект целиком
+        // и вызывает SortUnique один раз при его закрытии, а не сдвигает вектор на каждом ключе
+        void AppendUnsorted(value_type&& item);
+
+        // Упорядочивает пары по ключу; из повторяющихся ключей, как и при insert, остаётся первый
+        void SortUnique();
+
+        iterator find(std::string_view key);
+        const_iterator find(std::string_view key) const;
+
+        size_t count(std::string_view key) const;
+
+        Node& at(std::string_view key);
+        const Node& at(std::string_view key) const;
+
+        void reserve(size_t count);
+        size_t size() const;
+        bool empty() const;
+
+        iterator begin();
+        iterator end();
+        const_iterator begin() const;
+        const_iterator end() const;
+
+    private:
+        Container items_;
+    };
+
+    bool operator== (const Dict& lhs, const Dict& rhs);
+
+    bool operator!= (const Dict& lhs, const Dict& rhs);
+
     // ---------- NodePrinter -----------------------------------------------------
 
     class NodePrinterHelper {
@@ -100,7 +153,7 @@ namespace json {
 
     struct NodePrinter {
         void operator() (std::nullptr_t) const;
-        void operator() (const std::string& value) const;
+        void operator() (std::string_view value) const;
         void operator() (bool value) const;
         void operator() (int value) const;
         void operator() (double value) const;
@@ -118,14 +171,18 @@ namespace json {
 
     // ---------- Node ------------------------------------------------------------
 
-    class Node : private std::variant<std::nullptr_t, std::string, bool, int, double, Array, Dict> {
+    /*
+    * Строка хранится либо в std::string, либо в std::string_view на входной буфер,
+    * которым владеет json::Document. Для пользователя узла оба варианта - строка
+    */
+    class Node : private std::variant<std::nullptr_t, std::string, bool, int, double, Array, Dict, std::string_view> {
     public:
         using variant::variant;
         using NodeData = variant;
         using Value = variant;
 
     public:
-        const std::string& AsString() const;
+        std::string_view AsString() const;
         bool AsBool() const;
         int AsInt() const;
         double AsDouble() const;
@@ -133,7 +190,6 @@ namespace json {
         const Dict& AsMap() const;
         const Dict& AsDict() const;
 
-        std::string& AsString();
         Array& AsArray();
         Dict& AsMap();
         Dict& AsDict();
@@ -32,6 +32,11 @@ namespace json {
             return Node(std::move(value));
         }
 
+        Node NodeGetter::operator()(std::string_view&& value) const {
+            // Построенный документ владеет всеми своими строками
+            return Node(std::string(value));
+        }
+
     } // namespace detail
 
     KeyItemContext Builder::Key(std::string&& value) {
@@ -55,7 +60,7 @@ namespace json {
             Node key_node = *nodes_stack_.back();
             nodes_stack_.pop_back();
             Dict& value = nodes_stack_.back()->AsDict();
-            value.insert({ key_node.AsString(), std::move(node) });
+            value.insert({ std::string(key_node.AsString()), std::move(node) });
         }
         else {
             throw std::logic_error("All objects have been done");
@@ -21,6 +21,7 @@ namespace json {
             Node operator() (double&& value) const;
             Node operator() (Array&& value) const;
             Node operator() (Dict&& value) const;
+            Node operator() (std::string_view&& value) const;
         };
 
     } // namespace detail
@@ -1,8 +1,13 @@
-#include <map>
-#include <set>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 
 #include "json_reader.h"
+#include "thread_pool.h"
 
 namespace json {
 
@@ -12,6 +17,11 @@ namespace json {
         : root_(std::move(root)) {
     }
 
+    Document::Document(Node root, std::shared_ptr<const std::string> buffer)
+        : buffer_(std::move(buffer))
+        , root_(std::move(root)) {
+    }
+
     const Node& Document::GetRoot() const {
         return root_;
     }
@@ -28,120 +38,211 @@ namespace json {
 
 #define TO_STR(str) (std::string(str))
 
-        static const std::set<char> skip_this = { ' ', '\t', '\r', '\n', ':' };
-
-        Node LoadNode(std::istream& input);
-
-        std::string LoadStringCount(std::istream& input, size_t count) {
-            std::string line;
-            for (char c; count > 0 && input >> c;) {
-                line += c;
-                count--;
+        // Классы символов для таблицы поиска
+        enum CharClass : uint8_t {
+            CHAR_OTHER = 0,
+            CHAR_SKIP = 1 << 0,         // пробельные символы и ':', пропускаемые перед значением
+            CHAR_COMMA = 1 << 1,        // разделитель элементов массива и словаря
+            CHAR_DIGIT = 1 << 2
+        };
+
+        constexpr std::array<uint8_t, 256> MakeCharClassTable() {
+            std::array<uint8_t, 256> table{};
+            table[static_cast<uint8_t>(' ')] = CHAR_SKIP;
+            table[static_cast<uint8_t>('\t')] = CHAR_SKIP;
+            table[static_cast<uint8_t>('\r')] = CHAR_SKIP;
+            table[static_cast<uint8_t>('\n')] = CHAR_SKIP;
+            table[static_cast<uint8_t>(':')] = CHAR_SKIP;
+            table[static_cast<uint8_t>(',')] = CHAR_COMMA;
+            for (char c = '0'; c <= '9'; ++c) {
+                table[static_cast<uint8_t>(c)] = CHAR_DIGIT;
             }
-            return line;
+            return table;
         }
 
-        bool LoadTypeCompare(std::istream& input, const std::string& check_word) {
-            return check_word == LoadStringCount(input, check_word.size());
+        static constexpr std::array<uint8_t, 256> char_class = MakeCharClassTable();
+
+        // Элементы потокового массива, не обработанные быстрым путём, разбираются параллельно,
+        // если занимают не меньше этого размера в байтах
+        static constexpr size_t PARALLEL_MIN_BYTES = 1 << 20;
+
+        // Количество элементов массива, разбираемых одной задачей пула потоков
+        static constexpr size_t PARALLEL_BATCH_SIZE = 256;
+
+        inline bool IsCharClass(char c, uint8_t mask) {
+            return (char_class[static_cast<uint8_t>(c)] & mask) != 0;
         }
 
-        void LoadTypeCheck(std::istream& input, const std::string& check_word, const std::string& error_msg) {
-            if (!LoadTypeCompare(input, check_word)) {
-                throw ParsingError(error_msg);
+        /*
+        * Разбор JSON из непрерывного буфера в памяти.
+        * Перемещается по буферу указателем, классы символов определяются таблицей поиска.
+        * Строит то же дерево json::Node и выбрасывает те же ParsingError, что и разбор из потока.
+        * В режиме StringStorage::VIEW строки без экранирования не копируются, а ссылаются на буфер
+        */
+        class BufferParser {
+        public:
+            BufferParser(std::string_view buffer, StringStorage storage)
+                : pos_(buffer.data())
+                , end_(buffer.data() + buffer.size())
+                , is_view_(storage == StringStorage::VIEW) {
             }
-        }
 
-#define LOAD_NULL_CHECK(input) (LoadTypeCheck(input, TO_STR("null"), TO_STR("Json LoadNull error")))
-#define LOAD_TRUE_CHECK(input) (LoadTypeCheck(input, TO_STR("true"), TO_STR("Json LoadTrue error")))
-#define LOAD_FALSE_CHECK(input) (LoadTypeCheck(input, TO_STR("false"), TO_STR("Json LoadFalse error")))
+            Node LoadNode();
 
-        Node LoadNull(std::istream& input) {
-            LOAD_NULL_CHECK(input);
-            return Node();
-        }
+            // Разбирает очередное значение, сообщая обработчику о его элементах
+            void LoadSax(SaxHandler& handler);
+
+            // Разбирает словарь верхнего уровня. Элементы массивов с ключами из streamed
+            // передаются обработчикам по порядку и в словарь не попадают
+            Dict LoadStreamedRoot(const std::unordered_map<std::string, StreamedArray>& streamed);
+
+            // Количество разобранных байт
+            size_t Consumed(std::string_view buffer) const {
+                return static_cast<size_t>(pos_ - buffer.data());
+            }
 
-        Node LoadString(std::istream& input) {
-            static const std::map<char, char> escape{
-                {'r', '\r'},
-                {'n', '\n'},
-                {'t', '\t'}
+        private:
+            // Границы элементов массива, найденные без построения узлов
+            struct ScannedArray {
+                std::vector<std::string_view> items;
+                const char* end = nullptr;
             };
 
-            std::string line;
+            void SkipWhile(uint8_t mask) {
+                while (pos_ != end_ && IsCharClass(*pos_, mask)) {
+                    ++pos_;
+                }
+            }
+
+            void LoadLiteral(std::string_view check_word, const char* error_msg);
+
+            // Возвращает строку без экранированных символов как участок буфера,
+            // иначе оставляет позицию без изменений
+            std::optional<std::string_view> LoadStringView();
+
+            std::string LoadString();
+            Node LoadStringNode();
+            Node LoadNumber();
+            Node LoadArray();
+            Node LoadDict();
+
+            // Разбирает потоковый массив, начиная с первого элемента
+            void LoadStreamedArray(const StreamedArray& streamed, const Dict& root);
+
+            // Находит границы элементов массива, не меняя позицию.
+            // Возвращает std::nullopt, если массив не закрыт или содержит незакрытые строки
+            std::optional<ScannedArray> ScanArrayItems() const;
+
+            // Возвращает конец значения, начинающегося в pos, или nullptr
+            const char* SkipValue(const char* pos) const;
+
+            // Разбирает элементы в пуле потоков и передаёт их callback по порядку.
+            // Если элемент разобрать не удалось, возвращает false и устанавливает позицию на его
+            // начало: оставшиеся элементы разбираются последовательно с теми же ошибками
+            bool LoadItemsParallel(const std::vector<std::string_view>& items, const ItemCallback& callback, const Dict& root);
+
+        private:
+            const char* pos_;
+            const char* end_;
+            const bool is_view_;
+        };
 
-            input >> std::noskipws;
+        void BufferParser::LoadLiteral(std::string_view check_word, const char* error_msg) {
+            if (static_cast<size_t>(end_ - pos_) < check_word.size()
+                || std::string_view(pos_, check_word.size()) != check_word) {
+                throw ParsingError(TO_STR(error_msg));
+            }
+            pos_ += check_word.size();
+        }
 
-            if (input.peek() == '\"') {
-                input.get();
+        std::optional<std::string_view> BufferParser::LoadStringView() {
+            const char* stop = pos_;
+            while (stop != end_ && *stop != '\"' && *stop != '\\') {
+                ++stop;
+            }
+            if (stop == end_ || *stop != '\"') {
+                return std::nullopt;
             }
 
-            bool is_closed = false;
+            std::string_view value(pos_, static_cast<size_t>(stop - pos_));
+            pos_ = stop + 1;
+            return value;
+        }
+
+        std::string BufferParser::LoadString() {
+            std::string line;
+
+            for (const char* start = pos_; pos_ != end_; start = pos_) {
+                // Копируем участок без управляющих символов целиком
+                while (pos_ != end_ && *pos_ != '\"' && *pos_ != '\\') {
+                    ++pos_;
+                }
+                line.append(start, pos_);
 
-            for (char c; input >> c;) {
-                is_closed = (c == '\"');
-                if (is_closed) {
+                if (pos_ == end_) {
                     break;
                 }
-                if (c == '\\') {
-                    input >> c;
-                    if (escape.count(c)) {
-                        line += escape.at(c);
-                    }
-                    else {
-                        line += c;
-                    }
+                if (*pos_ == '\"') {
+                    ++pos_;
+                    return line;
                 }
-                else {
+
+                // Экранированный символ
+                if (++pos_ == end_) {
+                    break;
+                }
+                switch (const char c = *pos_++) {
+                case 'r':
+                    line += '\r';
+                    break;
+                case 'n':
+                    line += '\n';
+                    break;
+                case 't':
+                    line += '\t';
+                    break;
+                default:
                     line += c;
                 }
             }
 
-            if (!is_closed) {
-                throw ParsingError(TO_STR("Quote must be closed in string"));
-            }
-
-            return Node(move(line));
-        }
-
-        Node LoadTrue(std::istream& input) {
-            LOAD_TRUE_CHECK(input);
-            return Node(true);
+            throw ParsingError(TO_STR("Quote must be closed in string"));
         }
 
-        Node LoadFalse(std::istream& input) {
-            LOAD_FALSE_CHECK(input);
-            return Node(false);
+        Node BufferParser::LoadStringNode() {
+            if (is_view_) {
+                if (auto value = LoadStringView()) {
+                    return Node(*value);
+                }
+            }
+            return Node(LoadString());
         }
 
-        Node LoadNumber(std::istream& input) {
+        Node BufferParser::LoadNumber() {
             using namespace std::literals;
 
-            std::string parsed_num;
+            const char* start = pos_;
 
-            // Считывает в parsed_num очередной символ из input
-            auto read_char = [&parsed_num, &input] {
-                parsed_num += static_cast<char>(input.get());
-                if (!input) {
-                    throw ParsingError("Failed to read number from stream"s);
-                }
-            };
-
-            // Считывает одну или более цифр в parsed_num из input
-            auto read_digits = [&input, read_char] {
-                if (!std::isdigit(input.peek())) {
+            // Считывает одну или более цифр
+            auto read_digits = [this] {
+                if (pos_ == end_ || !IsCharClass(*pos_, CHAR_DIGIT)) {
                     throw ParsingError("A digit is expected"s);
                 }
-                while (std::isdigit(input.peek())) {
-                    read_char();
+                while (pos_ != end_ && IsCharClass(*pos_, CHAR_DIGIT)) {
+                    ++pos_;
                 }
             };
 
-            if (input.peek() == '-') {
-                read_char();
+            auto peek = [this] {
+                return (pos_ != end_) ? *pos_ : '\0';
+            };
+
+            if (peek() == '-') {
+                ++pos_;
             }
             // Парсим целую часть числа
-            if (input.peek() == '0') {
-                read_char();
+            if (peek() == '0') {
+                ++pos_;
                 // После 0 в JSON не могут идти другие цифры
             }
             else {
@@ -150,143 +251,514 @@ namespace json {
 
             bool is_int = true;
             // Парсим дробную часть числа
-            if (input.peek() == '.') {
-                read_char();
+            if (peek() == '.') {
+                ++pos_;
                 read_digits();
                 is_int = false;
             }
 
             // Парсим экспоненциальную часть числа
-            if (int ch = input.peek(); ch == 'e' || ch == 'E') {
-                read_char();
-                if (ch = input.peek(); ch == '+' || ch == '-') {
-                    read_char();
+            if (char ch = peek(); ch == 'e' || ch == 'E') {
+                ++pos_;
+                if (ch = peek(); ch == '+' || ch == '-') {
+                    ++pos_;
                 }
                 read_digits();
                 is_int = false;
             }
 
-            try {
-                if (is_int) {
-                    // Сначала пробуем преобразовать строку в int
-                    try {
-                        return Node(std::stoi(parsed_num));
-                    }
-                    catch (...) {
-                        // В случае неудачи, например, при переполнении
-                        // код ниже попробует преобразовать строку в double
-                    }
+            if (is_int) {
+                // Сначала пробуем преобразовать в int, при переполнении число разбирается как double
+                int value = 0;
+                if (auto [ptr, ec] = std::from_chars(start, pos_, value); ec == std::errc{} && ptr == pos_) {
+                    return Node(value);
                 }
-                return Node(std::stod(parsed_num));
             }
-            catch (...) {
-                throw ParsingError("Failed to convert "s + parsed_num + " to number"s);
+
+            double value = 0.0;
+            if (auto [ptr, ec] = std::from_chars(start, pos_, value); ec != std::errc{} || ptr != pos_) {
+                throw ParsingError("Failed to convert "s + std::string(start, pos_) + " to number"s);
             }
+            return Node(value);
         }
 
-        Node LoadArray(std::istream& input) {
+        Node BufferParser::LoadArray() {
             Array result;
 
-            bool is_closed = false;
-            for (char c; input >> c;) {
-                if (is_closed = (c == ']'); is_closed) {
-                    break;
+            while (true) {
+                SkipWhile(CHAR_SKIP | CHAR_COMMA);
+                if (pos_ == end_) {
+                    throw ParsingError(TO_STR("Brackets must be closed in Array"));
                 }
-                if (skip_this.count(c) > 0 || c == ',') {
-                    continue;
+                if (*pos_ == ']') {
+                    ++pos_;
+                    break;
                 }
-                input.putback(c);
-                result.push_back(LoadNode(input));
-            }
-
-            if (!is_closed) {
-                throw ParsingError(TO_STR("Brackets must be closed in Array"));
+                result.push_back(LoadNode());
             }
 
-            return Node(move(result));
+            return Node(std::move(result));
         }
 
-        Node LoadDict(std::istream& input) {
+        Node BufferParser::LoadDict() {
             Dict result;
 
-            bool is_closed = false;
-            for (char c; input >> c;) {
-                if (is_closed = (c == '}'); is_closed) {
-                    break;
+            while (true) {
+                SkipWhile(CHAR_SKIP | CHAR_COMMA);
+                if (pos_ == end_) {
+                    throw ParsingError(TO_STR("Brackets must be closed in Dict"));
                 }
-                if (skip_this.count(c) > 0 || c == ',') {
-                    continue;
+                if (*pos_ == '}') {
+                    ++pos_;
+                    break;
                 }
 
-                std::string key = LoadString(input).AsString();
-                input >> c;
-                result.insert({ std::move(key), LoadNode(input) });
+                if (*pos_ == '\"') {
+                    ++pos_;
+                }
+                std::string key = LoadString();
+                result.AppendUnsorted({ std::move(key), LoadNode() });
             }
 
-            if (!is_closed) {
-                throw ParsingError(TO_STR("Brackets must be closed in Dict"));
+            result.SortUnique();
+            return Node(std::move(result));
+        }
+
+        Node BufferParser::LoadNode() {
+            SkipWhile(CHAR_SKIP);
+            if (pos_ == end_) {
+                throw ParsingError(TO_STR("Unexpected end of input"));
             }
 
-            return Node(std::move(result));
+            switch (*pos_) {
+            case '[':
+                ++pos_;
+                return LoadArray();
+            case '{':
+                ++pos_;
+                return LoadDict();
+            case '"':
+                ++pos_;
+                return LoadStringNode();
+            case 'n':
+                LoadLiteral("null", "Json LoadNull error");
+                return Node();
+            case 't':
+                LoadLiteral("true", "Json LoadTrue error");
+                return Node(true);
+            case 'f':
+                LoadLiteral("false", "Json LoadFalse error");
+                return Node(false);
+            default:
+                return LoadNumber();
+            }
         }
 
-        Node LoadNode(std::istream& input) {
-            char c;
-            input >> c;
+        void BufferParser::LoadSax(SaxHandler& handler) {
+            SkipWhile(CHAR_SKIP);
+            if (pos_ == end_) {
+                throw ParsingError(TO_STR("Unexpected end of input"));
+            }
 
-            if (skip_this.count(c) > 0) {
-                return LoadNode(input);
+            switch (*pos_) {
+            case '[':
+                ++pos_;
+                handler.StartArray();
+                while (true) {
+                    SkipWhile(CHAR_SKIP | CHAR_COMMA);
+                    if (pos_ == end_) {
+                        throw ParsingError(TO_STR("Brackets must be closed in Array"));
+                    }
+                    if (*pos_ == ']') {
+                        ++pos_;
+                        break;
+                    }
+                    LoadSax(handler);
+                }
+                handler.EndArray();
+                break;
+            case '{':
+                ++pos_;
+                handler.StartDict();
+                while (true) {
+                    SkipWhile(CHAR_SKIP | CHAR_COMMA);
+                    if (pos_ == end_) {
+                        throw ParsingError(TO_STR("Brackets must be closed in Dict"));
+                    }
+                    if (*pos_ == '}') {
+                        ++pos_;
+                        break;
+                    }
+                    if (*pos_ == '\"') {
+                        ++pos_;
+                    }
+                    if (auto key = is_view_ ? LoadStringView() : std::nullopt) {
+                        handler.KeyView(*key);
+                    }
+                    else {
+                        handler.Key(LoadString());
+                    }
+                    LoadSax(handler);
+                }
+                handler.EndDict();
+                break;
+            case '"':
+                ++pos_;
+                if (is_view_) {
+                    if (auto value = LoadStringView()) {
+                        handler.StringView(*value);
+                        break;
+                    }
+                }
+                handler.String(LoadString());
+                break;
+            case 'n':
+                LoadLiteral("null", "Json LoadNull error");
+                handler.Null();
+                break;
+            case 't':
+                LoadLiteral("true", "Json LoadTrue error");
+                handler.Bool(true);
+                break;
+            case 'f':
+                LoadLiteral("false", "Json LoadFalse error");
+                handler.Bool(false);
+                break;
+            default:
+                if (Node number = LoadNumber(); number.IsInt()) {
+                    handler.Int(number.AsInt());
+                }
+                else {
+                    handler.Double(number.AsDouble());
+                }
+            }
+        }
+
+        Dict BufferParser::LoadStreamedRoot(const std::unordered_map<std::string, StreamedArray>& streamed) {
+            SkipWhile(CHAR_SKIP);
+            if (pos_ == end_) {
+                throw ParsingError(TO_STR("Unexpected end of input"));
             }
-            else if (c == '[') {
-                return LoadArray(input);
+            if (*pos_ != '{') {
+                throw std::logic_error("Node data is not Dict format");
             }
-            else if (c == '{') {
-                return LoadDict(input);
+            ++pos_;
+
+            Dict root;
+            while (true) {
+                SkipWhile(CHAR_SKIP | CHAR_COMMA);
+                if (pos_ == end_) {
+                    throw ParsingError(TO_STR("Brackets must be closed in Dict"));
+                }
+                if (*pos_ == '}') {
+                    ++pos_;
+                    break;
+                }
+
+                if (*pos_ == '\"') {
+                    ++pos_;
+                }
+                std::string key = LoadString();
+
+                SkipWhile(CHAR_SKIP);
+                if (auto it = streamed.find(key); it != streamed.end() && pos_ != end_ && *pos_ == '[') {
+                    ++pos_;
+                    LoadStreamedArray(it->second, root);
+                    continue;
+                }
+                root.insert({ std::move(key), LoadNode() });
             }
-            else if (c == '"') {
-                return LoadString(input);
+
+            return root;
+        }
+
+        void BufferParser::LoadStreamedArray(const StreamedArray& streamed, const Dict& root) {
+            const bool is_parallel = thread_pool::ThreadPool::DefaultThreadCount() > 1;
+            if (streamed.on_texts || is_parallel) {
+                if (auto scanned = ScanArrayItems()) {
+                    std::vector<std::string_view>& items = scanned->items;
+                    const size_t processed = streamed.on_texts ? streamed.on_texts(items, root) : 0;
+                    items.erase(items.begin(), items.begin() + processed);
+                    if (items.empty()) {
+                        pos_ = scanned->end;
+                        return;
+                    }
+
+                    // Элементы, не обработанные быстрым путём, разбираются в пуле потоков, если их много
+                    if (is_parallel && static_cast<size_t>(scanned->end - items.front().data()) >= PARALLEL_MIN_BYTES) {
+                        if (LoadItemsParallel(items, streamed.on_item, root)) {
+                            pos_ = scanned->end;
+                            return;
+                        }
+                    }
+                    else {
+                        pos_ = items.front().data();
+                    }
+                }
             }
-            else if (c == 'n') {
-                input.putback(c);
-                return LoadNull(input);
+
+            while (true) {
+                SkipWhile(CHAR_SKIP | CHAR_COMMA);
+                if (pos_ == end_) {
+                    throw ParsingError(TO_STR("Brackets must be closed in Array"));
+                }
+                if (*pos_ == ']') {
+                    ++pos_;
+                    return;
+                }
+                streamed.on_item(LoadNode(), root);
             }
-            else if (c == 't') {
-                input.putback(c);
-                return LoadTrue(input);
+        }
+
+        std::optional<BufferParser::ScannedArray> BufferParser::ScanArrayItems() const {
+            ScannedArray result;
+            const char* pos = pos_;
+            while (true) {
+                while (pos != end_ && IsCharClass(*pos, CHAR_SKIP | CHAR_COMMA)) {
+                    ++pos;
+                }
+                if (pos == end_) {
+                    return std::nullopt;
+                }
+                if (*pos == ']') {
+                    result.end = pos + 1;
+                    return result;
+                }
+
+                const char* item_end = SkipValue(pos);
+                if (item_end == nullptr) {
+                    return std::nullopt;
+                }
+                result.items.emplace_back(pos, static_cast<size_t>(item_end - pos));
+                pos = item_end;
             }
-            else if (c == 'f') {
-                input.putback(c);
-                return LoadFalse(input);
+        }
+
+        const char* BufferParser::SkipValue(const char* pos) const {
+            size_t depth = 0;
+            do {
+                switch (*pos) {
+                case '[':
+                case '{':
+                    ++depth;
+                    ++pos;
+                    break;
+                case ']':
+                case '}':
+                    if (depth == 0) {
+                        return nullptr;
+                    }
+                    --depth;
+                    ++pos;
+                    break;
+                case '"':
+                    for (++pos; pos != end_ && *pos != '"'; ++pos) {
+                        if (*pos == '\\' && ++pos == end_) {
+                            return nullptr;
+                        }
+                    }
+                    if (pos == end_) {
+                        return nullptr;
+                    }
+                    ++pos;
+                    break;
+                default:
+                    if (depth > 0) {
+                        ++pos;
+                        break;
+                    }
+                    // Число или литерал верхнего уровня заканчивается на разделителе или скобке
+                    while (pos != end_ && !IsCharClass(*pos, CHAR_SKIP | CHAR_COMMA)
+                        && *pos != '[' && *pos != ']' && *pos != '{' && *pos != '}' && *pos != '"') {
+                        ++pos;
+                    }
+                    return pos;
+                }
+            } while (depth > 0 && pos != end_);
+
+            return (depth == 0) ? pos : nullptr;
+        }
+
+        bool BufferParser::LoadItemsParallel(const std::vector<std::string_view>& items, const ItemCallback& callback, const Dict& root) {
+            const StringStorage storage = is_view_ ? StringStorage::VIEW : StringStorage::COPY;
+
+            // Элемент разобран так же, как при последовательном разборе, только если разбор
+            // закончился ровно на его границе
+            auto parse_item = [&items, storage](size_t i) {
+                return LoadExact(items[i], storage);
+            };
+
+            const size_t processed = thread_pool::ForEachOrdered(items.size(), PARALLEL_BATCH_SIZE, parse_item,
+                [&callback, &root](std::optional<Node>&& node) {
+                    if (!node) {
+                        return false;
+                    }
+                    callback(std::move(*node), root);
+                    return true;
+                });
+
+            if (processed < items.size()) {
+                pos_ = items[processed].data();
+                return false;
             }
-            else {
-                input.putback(c);
-                return LoadNumber(input);
+            return true;
+        }
+
+        std::string ReadAll(std::istream& input) {
+            std::string buffer;
+            std::array<char, 1 << 16> chunk;
+            while (input.read(chunk.data(), chunk.size()) || input.gcount() > 0) {
+                buffer.append(chunk.data(), static_cast<size_t>(input.gcount()));
             }
+            return buffer;
         }
 
     } // namespace detail
 
-    Document Load(std::istream& input) {
-        return Document{ detail::LoadNode(input) };
+    Document Load(std::istream& input, StringStorage storage) {
+        if (storage == StringStorage::COPY) {
+            return Load(detail::ReadAll(input));
+        }
+        auto buffer = std::make_shared<const std::string>(detail::ReadAll(input));
+        Node root = detail::BufferParser(*buffer, storage).LoadNode();
+        return Document{ std::move(root), std::move(buffer) };
+    }
+
+    Document Load(std::string_view buffer) {
+        return Document{ detail::BufferParser(buffer, StringStorage::COPY).LoadNode() };
+    }
+
+    std::optional<Node> LoadExact(std::string_view buffer, StringStorage storage) {
+        detail::BufferParser parser(buffer, storage);
+        try {
+            Node node = parser.LoadNode();
+            if (parser.Consumed(buffer) == buffer.size()) {
+                return node;
+            }
+        }
+        catch (const ParsingError&) {
+        }
+        return std::nullopt;
     }
 
     void Print(const Document& doc, std::ostream& output) {
         std::visit(NodePrinter{ output }, doc.GetRoot().Data());
     }
 
+    size_t LoadSax(std::string_view buffer, SaxHandler& handler, StringStorage storage) {
+        detail::BufferParser parser(buffer, storage);
+        parser.LoadSax(handler);
+        return parser.Consumed(buffer);
+    }
+
+    Document LoadStreamed(
+        std::istream& input,
+        const std::unordered_map<std::string, StreamedArray>& streamed,
+        StringStorage storage) {
+        auto buffer = std::make_shared<const std::string>(detail::ReadAll(input));
+        Dict root = detail::BufferParser(*buffer, storage).LoadStreamedRoot(streamed);
+        if (storage == StringStorage::COPY) {
+            return Document{ std::move(root) };
+        }
+        return Document{ std::move(root), std::move(buffer) };
+    }
+
+    // ---------- NodeCollector ---------------------------------------------------
+
+    void NodeCollector::Null() {
+        Push(Node());
+    }
+
+    void NodeCollector::Bool(bool value) {
+        Push(Node(value));
+    }
+
+    void NodeCollector::Int(int value) {
+        Push(Node(value));
+    }
+
+    void NodeCollector::Double(double value) {
+        Push(Node(value));
+    }
+
+    void NodeCollector::String(std::string&& value) {
+        Push(Node(std::move(value)));
+    }
+
+    void NodeCollector::StringView(std::string_view value) {
+        Push(Node(value));
+    }
+
+    void NodeCollector::Key(std::string&& key) {
+        keys_.push_back(std::move(key));
+    }
+
+    void NodeCollector::KeyView(std::string_view key) {
+        keys_.emplace_back(key);
+    }
+
+    void NodeCollector::StartArray() {
+        stack_.emplace_back(Array{});
+    }
+
+    void NodeCollector::EndArray() {
+        Node node = std::move(stack_.back());
+        stack_.pop_back();
+        Push(std::move(node));
+    }
+
+    void NodeCollector::StartDict() {
+        stack_.emplace_back(Dict{});
+    }
+
+    void NodeCollector::EndDict() {
+        Node node = std::move(stack_.back());
+        stack_.pop_back();
+        node.AsDict().SortUnique();
+        Push(std::move(node));
+    }
+
+    Node NodeCollector::Extract() {
+        Node node = std::move(*root_);
+        root_.reset();
+        return node;
+    }
+
+    void NodeCollector::Push(Node&& node) {
+        if (stack_.empty()) {
+            root_ = std::move(node);
+        }
+        else if (stack_.back().IsArray()) {
+            stack_.back().AsArray().push_back(std::move(node));
+        }
+        else {
+            stack_.back().AsDict().AppendUnsorted({ std::move(keys_.back()), std::move(node) });
+            keys_.pop_back();
+        }
+    }
+
     // ---------- Reader ----------------------------------------------------------
 
     Reader::Reader(std::istream& input)
-        : doc_(std::move(json::Load(input))) {
-        using namespace std::string_literals;
+        : doc_(json::Load(input, StringStorage::VIEW)) {
+        Init();
+    }
+
+    Reader::Reader(std::istream& input, const std::unordered_map<std::string, StreamedArray>& streamed)
+        : doc_(json::LoadStreamed(input, streamed, StringStorage::VIEW)) {
+        Init();
+    }
+
+    void Reader::Init() {
+        using namespace std::literals;
 
         const json::Dict& input_requests = doc_.GetRoot().AsMap();
 
-        if (input_requests.count("base_requests"s) > 0) {
-            InitBaseRequests(input_requests.at("base_requests"s).AsArray());
+        if (input_requests.count("base_requests"sv) > 0) {
+            InitBaseRequests(input_requests.at("base_requests"sv).AsArray());
         }
-        if (input_requests.count("stat_requests"s) > 0) {
-            InitStatRequests(input_requests.at("stat_requests"s).AsArray());
+        if (input_requests.count("stat_requests"sv) > 0) {
+            InitStatRequests(input_requests.at("stat_requests"sv).AsArray());
         }
         InitRenderSettings(input_requests);
         InitRoutingSettings(input_requests);
@@ -298,12 +770,12 @@ namespace json {
 
         for (const json::Node& node_request : base_requests) {
             const json::Dict& request = node_request.AsMap();
-            std::string_view type = request.at("type"s).AsString();
+            std::string_view type = request.at("type"sv).AsString();
             if (type == "Stop"sv) {
                 stop_requests_.push_back(&node_request);
                 road_distances_.insert({
-                    request.at("name"s).AsString(),
-                    &request.at("road_distances"s).AsMap()
+                    request.at("name"sv).AsString(),
+                    &request.at("road_distances"sv).AsMap()
                     });
             }
             else if (type == "Bus"sv) {
@@ -325,9 +797,9 @@ namespace json {
         using namespace std::literals;
         static const json::Dict empty_dict{};
 
-        bool is_render_settings = (input_requests.count("render_settings"s) > 0);
+        bool is_render_settings = (input_requests.count("render_settings"sv) > 0);
 
-        for (const auto& [name, node] : (is_render_settings) ? input_requests.at("render_settings"s).AsMap() : empty_dict) {
+        for (const auto& [name, node] : (is_render_settings) ? input_requests.at("render_settings"sv).AsMap() : empty_dict) {
             render_settings_.emplace(name, &node);
         }
     }
@@ -336,9 +808,9 @@ namespace json {
         using namespace std::literals;
         static const json::Dict empty_dict{};
 
-        bool is_routing_settings = (routing_settings.count("routing_settings"s) > 0);
+        bool is_routing_settings = (routing_settings.count("routing_settings"sv) > 0);
 
-        for (const auto& [name, node] : (is_routing_settings) ? routing_settings.at("routing_settings"s).AsMap() : empty_dict) {
+        for (const auto& [name, node] : (is_routing_settings) ? routing_settings.at("routing_settings"sv).AsMap() : empty_dict) {
             routing_settings_.emplace(name, &node);
         }
     }
@@ -347,9 +819,9 @@ namespace json {
         using namespace std::literals;
         static const json::Dict empty_dict{};
 
-        bool is_serialization_settings = (serialization_settings.count("serialization_settings"s) > 0);
+        bool is_serialization_settings = (serialization_settings.count("serialization_settings"sv) > 0);
 
-        for (const auto& [name, node] : (is_serialization_settings) ? serialization_settings.at("serialization_settings"s).AsMap() : empty_dict) {
+        for (const auto& [name, node] : (is_serialization_settings) ? serialization_settings.at("serialization_settings"sv).AsMap() : empty_dict) {
             serialization_settings_.emplace(name, &node);
         }
     }
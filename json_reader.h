@@ -1,6 +1,11 @@
 #pragma once
 
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -14,9 +19,13 @@ namespace json {
     public:
         explicit Document(Node root);
 
+        // Документ хранит входной буфер, на который ссылаются строки-представления его узлов
+        Document(Node root, std::shared_ptr<const std::string> buffer);
+
         const Node& GetRoot() const;
 
     private:
+        std::shared_ptr<const std::string> buffer_;
         Node root_;
     };
 
@@ -24,16 +33,136 @@ namespace json {
 
     bool operator!= (const Document& lhs, const Document& rhs);
 
-    Document Load(std::istream& input);
+    // Способ хранения строковых значений при разборе
+    enum class StringStorage {
+        COPY,   // каждая строка копируется в std::string
+        VIEW    // строки без экранированных символов ссылаются на входной буфер
+    };
+
+    // Загружает JSON, предварительно считав весь поток в буфер.
+    // В режиме VIEW буфер сохраняется в документе
+    Document Load(std::istream& input, StringStorage storage = StringStorage::COPY);
+
+    // Загружает JSON из непрерывного буфера в памяти
+    Document Load(std::string_view buffer);
+
+    // Разбирает одно JSON значение, занимающее весь буфер. Возвращает std::nullopt
+    // при ошибке разбора или если после значения в буфере остались данные
+    std::optional<Node> LoadExact(std::string_view buffer, StringStorage storage = StringStorage::COPY);
 
     void Print(const Document& doc, std::ostream& output);
 
+    // ---------- SaxHandler ------------------------------------------------------
+
+    // Интерфейс обработчика событий потокового (SAX) разбора JSON
+    class SaxHandler {
+    public:
+        virtual ~SaxHandler() = default;
+
+        virtual void Null() = 0;
+        virtual void Bool(bool value) = 0;
+        virtual void Int(int value) = 0;
+        virtual void Double(double value) = 0;
+        virtual void String(std::string&& value) = 0;
+
+        // Строка без экранированных символов, ссылающаяся на входной буфер (режим VIEW)
+        virtual void StringView(std::string_view value) {
+            String(std::string(value));
+        }
+
+        virtual void Key(std::string&& key) = 0;
+
+        // Ключ без экранированных символов, ссылающийся на входной буфер (режим VIEW)
+        virtual void KeyView(std::string_view key) {
+            Key(std::string(key));
+        }
+
+        virtual void StartArray() = 0;
+        virtual void EndArray() = 0;
+        virtual void StartDict() = 0;
+        virtual void EndDict() = 0;
+    };
+
+    // Разбирает JSON из буфера, сообщая обработчику о каждом элементе по мере разбора.
+    // Возвращает количество разобранных байт
+    size_t LoadSax(std::string_view buffer, SaxHandler& handler, StringStorage storage = StringStorage::COPY);
+
+    // ---------- NodeCollector ---------------------------------------------------
+
+    // Обработчик событий, собирающий из них одно значение json::Node
+    class NodeCollector : public SaxHandler {
+    public:
+        void Null() override;
+        void Bool(bool value) override;
+        void Int(int value) override;
+        void Double(double value) override;
+        void String(std::string&& value) override;
+        void StringView(std::string_view value) override;
+        void Key(std::string&& key) override;
+        void KeyView(std::string_view key) override;
+        void StartArray() override;
+        void EndArray() override;
+        void StartDict() override;
+        void EndDict() override;
+
+        // Значение собрано полностью
+        bool IsDone() const {
+            return root_.has_value();
+        }
+
+        // Сборка значения ещё не начата
+        bool IsIdle() const {
+            return !root_ && stack_.empty();
+        }
+
+        // Возвращает собранное значение и готовит сборщик к следующему
+        Node Extract();
+
+    private:
+        void Push(Node&& node);
+
+    private:
+        std::vector<Node> stack_;
+        std::vector<std::string> keys_;
+        std::optional<Node> root_;
+    };
+
+    // Обработчик элемента массива, разбираемого потоково.
+    // Вместе с элементом получает уже разобранные значения словаря верхнего уровня
+    using ItemCallback = std::function<void(Node&& item, const Dict& root)>;
+
+    // Обработчик исходных текстов всех элементов потокового массива. Тексты ссылаются
+    // на входной буфер. Возвращает количество обработанных с начала массива элементов
+    using ItemTextsCallback = std::function<size_t(const std::vector<std::string_view>& items, const Dict& root)>;
+
+    // Обработчики потокового массива
+    struct StreamedArray {
+        ItemCallback on_item;
+
+        // Необязательный быстрый путь для элементов известной структуры. Элементы,
+        // которые он не обработал, разбираются обычным образом и передаются on_item
+        ItemTextsCallback on_texts = nullptr;
+    };
+
+    // Загружает JSON-словарь верхнего уровня. Элементы массивов с ключами из streamed
+    // передаются обработчикам по мере разбора и в итоговый документ не попадают.
+    // В режиме VIEW строки элементов действительны, пока жив итоговый документ
+    Document LoadStreamed(
+        std::istream& input,
+        const std::unordered_map<std::string, StreamedArray>& streamed,
+        StringStorage storage = StringStorage::COPY);
+
     // ---------- Reader ----------------------------------------------------------
 
     class Reader {
     public:
         explicit Reader(std::istream& input);
 
+        // Потоковый режим: каждый элемент массивов с ключами из streamed (например, base_requests
+        // или stat_requests) передаётся обработчику сразу после разбора и не сохраняется,
+        // поэтому соответствующие StopRequests, BusRequests, RoadDistances и StatRequests остаются пустыми
+        Reader(std::istream& input, const std::unordered_map<std::string, StreamedArray>& streamed);
+
         const std::vector<const json::Node*>& StopRequests() const {
             return stop_requests_;
         }
@@ -63,6 +192,7 @@ namespace json {
         }
 
     private:
+        void Init();
         void InitBaseRequests(const json::Array& base_requests);
         void InitStatRequests(const json::Array& stat_requests);
         void InitRenderSettings(const json::Dict& input_requests);
@@ -0,0 +1,310 @@
+#include <array>
+#include <charconv>
+#include <stdexcept>
+#include <variant>
+
+#include "json_writer.h"
+
+namespace json {
+
+    namespace {
+
+        struct NodeWriter {
+            void operator() (std::nullptr_t) const {
+                writer.Value(nullptr);
+            }
+
+            void operator() (std::string_view value) const {
+                writer.Value(value);
+            }
+
+            void operator() (bool value) const {
+                writer.Value(value);
+            }
+
+            void operator() (int value) const {
+                writer.Value(value);
+            }
+
+            void operator() (double value) const {
+                writer.Value(value);
+            }
+
+            void operator() (const Array& value) const {
+                writer.StartArray();
+                for (const Node& node : value) {
+                    writer.Value(node);
+                }
+                writer.EndArray();
+            }
+
+            void operator() (const Dict& value) const {
+                writer.StartDict();
+                for (const auto& [key, node] : value) {
+                    writer.Key(key).Value(node);
+                }
+                writer.EndDict();
+            }
+
+            Writer& writer;
+        };
+
+        void AppendEscaped(std::string& out, std::string_view value) {
+            out += '"';
+            size_t start = 0;
+            for (size_t i = 0; i < value.size(); ++i) {
+                const char* escaped = nullptr;
+                switch (value[i]) {
+                case '"':
+                    escaped = "\\\"";
+                    break;
+                case '\\':
+                    escaped = "\\\\";
+                    break;
+                case '\t':
+                    escaped = "\\t";
+                    break;
+                case '\r':
+                    escaped = "\\r";
+                    break;
+                case '\n':
+                    escaped = "\\n";
+                    break;
+                default:
+                    continue;
+                }
+                out.append(value.data() + start, i - start);
+                out += escaped;
+                start = i + 1;
+            }
+            out.append(value.data() + start, value.size() - start);
+            out += '"';
+        }
+
+    } // namespace
+
+    Writer::Writer(std::ostream& out, bool is_compact)
+        : out_(&out)
+        , is_compact_(is_compact)
+        , precision_(static_cast<int>(out.precision())) {
+        buffer_.reserve(FLUSH_THRESHOLD);
+    }
+
+    Writer::Writer(bool is_compact, size_t indent, int precision)
+        : out_(nullptr)
+        , indent_(indent)
+        , is_compact_(is_compact)
+        , precision_(precision) {
+    }
+
+    Writer::~Writer() {
+        Flush();
+    }
+
+    Writer Writer::MakeItemWriter() const {
+        return Writer(is_compact_, indent_, precision_);
+    }
+
+    std::string Writer::Extract() {
+        return std::move(buffer_);
+    }
+
+    Writer& Writer::Key(std::string_view key) {
+        if (levels_.empty() || !levels_.back().is_dict || is_key_written_) {
+            throw std::logic_error("Key method expects a Dict(map) waiting for a key");
+        }
+        Level& level = levels_.back();
+        if (!level.is_first) {
+            WriteSeparator();
+        }
+        level.is_first = false;
+        WriteIndent();
+        WriteString(key);
+        buffer_ += ':';
+        is_key_written_ = true;
+        return *this;
+    }
+
+    Writer& Writer::Value(std::nullptr_t) {
+        BeginValue();
+        buffer_ += "null";
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(std::string_view value) {
+        BeginValue();
+        WriteString(value);
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(const std::string& value) {
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(const char* value) {
+        return Value(std::string_view(value));
+    }
+
+    Writer& Writer::Value(bool value) {
+        BeginValue();
+        buffer_ += value ? "true" : "false";
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(int value) {
+        BeginValue();
+        std::array<char, 16> chars;
+        auto [end, ec] = std::to_chars(chars.data(), chars.data() + chars.size(), value);
+        buffer_.append(chars.data(), end);
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(double value) {
+        BeginValue();
+        // Формат general с точностью потока даёт тот же результат, что и NodePrinter
+        std::array<char, 64> chars;
+        auto [end, ec] = std::to_chars(chars.data(), chars.data() + chars.size(), value,
+            std::chars_format::general, precision_);
+        if (ec != std::errc{}) {
+            throw std::logic_error("Failed to write double value");
+        }
+        buffer_.append(chars.data(), end);
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::Value(const Node& value) {
+        std::visit(NodeWriter{ *this }, value.Data());
+        return *this;
+    }
+
+    Writer& Writer::RawValue(std::string_view json) {
+        BeginValue();
+        if (out_ != nullptr && json.size() >= FLUSH_THRESHOLD) {
+            // Крупное значение передаётся в поток напрямую, минуя буфер
+            Flush();
+            out_->write(json.data(), static_cast<std::streamsize>(json.size()));
+        }
+        else {
+            buffer_.append(json);
+            FlushIfFull();
+        }
+        return *this;
+    }
+
+    Writer& Writer::StartDict() {
+        BeginValue();
+        buffer_ += '{';
+        WriteNewLine();
+        levels_.push_back({ true, true });
+        indent_ += INDENT_STEP;
+        return *this;
+    }
+
+    Writer& Writer::StartArray() {
+        BeginValue();
+        buffer_ += '[';
+        WriteNewLine();
+        levels_.push_back({ false, true });
+        indent_ += INDENT_STEP;
+        return *this;
+    }
+
+    Writer& Writer::EndDict() {
+        if (levels_.empty() || !levels_.back().is_dict || is_key_written_) {
+            throw std::logic_error("EndDict method could only \"end\" the Dict");
+        }
+        levels_.pop_back();
+        indent_ -= INDENT_STEP;
+        WriteNewLine();
+        WriteIndent();
+        buffer_ += '}';
+        FlushIfFull();
+        return *this;
+    }
+
+    Writer& Writer::EndArray() {
+        if (levels_.empty() || levels_.back().is_dict) {
+            throw std::logic_error("EndArray method could only \"end\" the Array");
+        }
+        levels_.pop_back();
+        indent_ -= INDENT_STEP;
+        WriteNewLine();
+        WriteIndent();
+        buffer_ += ']';
+        FlushIfFull();
+        return *this;
+    }
+
+    void Writer::Flush() {
+        if (out_ != nullptr && !buffer_.empty()) {
+            out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+            buffer_.clear();
+        }
+    }
+
+    void Writer::BeginValue() {
+        // Отступ значения верхнего уровня записывает тот, кто вкладывает его в массив
+        if (levels_.empty()) {
+            return;
+        }
+
+        Level& level = levels_.back();
+        if (level.is_dict) {
+            if (!is_key_written_) {
+                throw std::logic_error("Value in Dict(map) expects a key before it");
+            }
+            // Значение словаря отделяется от ключа одним пробелом
+            if (!is_compact_) {
+                buffer_ += ' ';
+            }
+            is_key_written_ = false;
+        }
+        else {
+            if (!level.is_first) {
+                WriteSeparator();
+            }
+            level.is_first = false;
+            WriteIndent();
+        }
+    }
+
+    void Writer::WriteIndent() {
+        if (!is_compact_) {
+            buffer_.append(indent_, ' ');
+        }
+    }
+
+    void Writer::WriteNewLine() {
+        if (!is_compact_) {
+            buffer_ += '\n';
+        }
+    }
+
+    void Writer::WriteSeparator() {
+        buffer_ += ',';
+        WriteNewLine();
+    }
+
+    void Writer::WriteString(std::string_view value) {
+        AppendEscaped(buffer_, value);
+    }
+
+    void Writer::FlushIfFull() {
+        if (buffer_.size() >= FLUSH_THRESHOLD) {
+            Flush();
+        }
+    }
+
+    std::string EscapeString(std::string_view value) {
+        std::string result;
+        result.reserve(value.size() + 2);
+        AppendEscaped(result, value);
+        return result;
+    }
+
+} // namespace json
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "json.h"
+
+namespace json {
+
+    /*
+    * Класс для потоковой записи JSON.
+    * Повторяет интерфейс json::Builder, но не строит дерево json::Node:
+    * каждый вызов сразу сериализует значение в растущий буфер, который
+    * сбрасывается в поток вывода по мере заполнения.
+    * По умолчанию формат вывода совпадает с json::Print,
+    * в компактном режиме JSON записывается без пробелов и переводов строк
+    */
+    class Writer {
+    public:
+        explicit Writer(std::ostream& out, bool is_compact = false);
+
+        Writer(const Writer&) = delete;
+        Writer& operator= (const Writer&) = delete;
+
+        ~Writer();
+
+        // Создаёт писатель, накапливающий одно значение в строке вместо потока.
+        // Значение форматируется как очередной элемент текущего массива этого писателя,
+        // чтобы затем передать его в RawValue. Может вызываться из разных потоков,
+        // пока у этого писателя не начинаются и не завершаются массивы и словари
+        Writer MakeItemWriter() const;
+
+        // Возвращает накопленную строку писателя, созданного MakeItemWriter
+        std::string Extract();
+
+        // Задаёт строковое значение ключа для очередной пары ключ-значение
+        Writer& Key(std::string_view key);
+
+        // Записывает значение, соответствующее ключу, или очередной элемент массива
+        Writer& Value(std::nullptr_t);
+        Writer& Value(std::string_view value);
+        Writer& Value(const std::string& value);
+        Writer& Value(const char* value);
+        Writer& Value(bool value);
+        Writer& Value(int value);
+        Writer& Value(double value);
+        Writer& Value(const Node& value);
+
+        // Записывает уже сериализованное JSON значение без изменений
+        Writer& RawValue(std::string_view json);
+
+        // Начинает запись словаря
+        Writer& StartDict();
+
+        // Начинает запись массива
+        Writer& StartArray();
+
+        // Завершает запись словаря
+        Writer& EndDict();
+
+        // Завершает запись массива
+        Writer& EndArray();
+
+        // Передаёт накопленный буфер в поток вывода
+        void Flush();
+
+    private:
+        struct Level {
+            bool is_dict = false;
+            bool is_first = true;
+        };
+
+        Writer(bool is_compact, size_t indent, int precision);
+
+        void BeginValue();
+        void WriteIndent();
+        void WriteNewLine();
+        void WriteSeparator();
+        void WriteString(std::string_view value);
+        void FlushIfFull();
+
+    private:
+        static constexpr size_t INDENT_STEP = 4;
+        static constexpr size_t FLUSH_THRESHOLD = 1 << 16;
+
+        // Поток вывода; nullptr для писателя, накапливающего значение в строке
+        std::ostream* out_;
+        std::string buffer_;
+        std::vector<Level> levels_;
+        size_t indent_ = 0;
+        const bool is_compact_;
+        const int precision_;
+        bool is_key_written_ = false;
+    };
+
+    // Функция возвращает строку в виде JSON значения: в кавычках и с экранированием
+    std::string EscapeString(std::string_view value);
+
+} // namespace json
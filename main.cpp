@@ -8,13 +8,24 @@ int main(int argc, const char** argv) {
         return 1;
     }
 
-    RequestHandlerProcess rhp(std::cin, std::cout);
+    const auto options = request_handler::ParseProgrammOptions(argc, argv);
+    if (!options) {
+        return 1;
+    }
+
+    RequestHandlerProcess rhp(std::cin, std::cout, *options);
     if (type == request_handler::ProgrammType::MAKE_BASE) {
         rhp.ExecuteMakeBaseRequests();
     }
+    else if (type == request_handler::ProgrammType::PROCESS_REQUESTS && options->json_lines) {
+        rhp.ExecuteProcessRequestLines();
+    }
     else if (type == request_handler::ProgrammType::PROCESS_REQUESTS) {
         rhp.ExecuteProcessRequests();
     }
+    else if (type == request_handler::ProgrammType::SERVE) {
+        rhp.ExecuteServe();
+    }
     else {
         return 2;
     }
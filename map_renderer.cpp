@@ -108,27 +108,33 @@ namespace map_renderer {
     void MapRenderer::InitNotEmptyBuses(
         const transport_catalogue::bus_catalogue::Catalogue& buses) {
         for (const auto& [name, bus] : buses) {
-            if (bus->stops_on_route > 0) {
+            if (bus->GetStopsOnRoute() > 0) {
                 buses_.emplace(name, bus);
             }
         }
     }
 
     void MapRenderer::CalculateZoomCoef() {
-        const auto [bottom_it, top_it] = std::minmax_element(stop_point_.begin(), stop_point_.end(),
-            [](const auto& lhs, const auto& rhs) {
-                return lhs.first->coord.lat < rhs.first->coord.lat;
-            });
-
-        const auto [left_it, right_it] = std::minmax_element(stop_point_.begin(), stop_point_.end(),
-            [](const auto& lhs, const auto& rhs) {
-                return lhs.first->coord.lng < rhs.first->coord.lng;
-            });
-
-        double min_lat = bottom_it->first->coord.lat;
-        double max_lat = top_it->first->coord.lat;
-        double min_lon = left_it->first->coord.lng;
-        double max_lon = right_it->first->coord.lng;
+        // Границы карты считаются одним проходом по непустым остановкам
+        bool is_first = true;
+        double min_lat = 0.0;
+        double max_lat = 0.0;
+        double min_lon = 0.0;
+        double max_lon = 0.0;
+
+        for (const auto& [stop, point] : stop_point_) {
+            const Coordinates& coord = stop->GetCoordinates();
+            if (is_first) {
+                min_lat = max_lat = coord.lat;
+                min_lon = max_lon = coord.lng;
+                is_first = false;
+                continue;
+            }
+            min_lat = std::min(min_lat, coord.lat);
+            max_lat = std::max(max_lat, coord.lat);
+            min_lon = std::min(min_lon, coord.lng);
+            max_lon = std::max(max_lon, coord.lng);
+        }
 
         double delta_lat = max_lat - min_lat;
         double delta_lon = max_lon - min_lon;
@@ -143,8 +149,8 @@ namespace map_renderer {
 
     void MapRenderer::CalculateStopZoomedCoords() {
         for (auto& [stop, point] : stop_point_) {
-            point.x = (stop->coord.lng - min_longitude_) * zoom_coef_ + render_settings_.padding;
-            point.y = (max_latitude_ - stop->coord.lat) * zoom_coef_ + render_settings_.padding;
+            point.x = (stop->GetCoordinates().lng - min_longitude_) * zoom_coef_ + render_settings_.padding;
+            point.y = (max_latitude_ - stop->GetCoordinates().lat) * zoom_coef_ + render_settings_.padding;
         }
     }
 
@@ -152,13 +158,14 @@ namespace map_renderer {
         size_t color_index = 0;
         for (const auto& [name, bus] : buses_) {
             svg::Polyline polyline = CreateLine(color_index++);
+            const auto route = bus->GetRoute();
 
-            for (const auto& stop : bus->route) {
+            for (const auto& stop : route) {
                 polyline.AddPoint(stop_point_.at(stop));
             }
 
-            if (bus->route_type == transport_catalogue::RouteType::BackAndForth && !bus->route.empty()) {
-                for (auto it = bus->route.rbegin() + 1; it != bus->route.rend(); ++it) {
+            if (bus->GetRouteType() == transport_catalogue::RouteType::BackAndForth && !route.empty()) {
+                for (auto it = route.rbegin() + 1; it != route.rend(); ++it) {
                     polyline.AddPoint(stop_point_.at(*it));
                 }
             }
@@ -172,16 +179,17 @@ namespace map_renderer {
         for (const auto& [name, bus] : buses_) {
             svg::Text underlayer_text = CreateUnderlayerBusText().SetData(std::string(name));
             svg::Text data_text = CreateDataBusText(color_index++).SetData(std::string(name));;
+            const auto route = bus->GetRoute();
 
-            underlayer_text.SetPosition(stop_point_.at(bus->route.front()));
-            data_text.SetPosition(stop_point_.at(bus->route.front()));
+            underlayer_text.SetPosition(stop_point_.at(route.front()));
+            data_text.SetPosition(stop_point_.at(route.front()));
 
             Add(underlayer_text);
             Add(data_text);
 
-            if (bus->route_type == transport_catalogue::RouteType::BackAndForth && !bus->route.empty() && *bus->route.front() != *bus->route.back()) {
-                underlayer_text.SetPosition(stop_point_.at(bus->route.back()));
-                data_text.SetPosition(stop_point_.at(bus->route.back()));
+            if (bus->GetRouteType() == transport_catalogue::RouteType::BackAndForth && !route.empty() && *route.front() != *route.back()) {
+                underlayer_text.SetPosition(stop_point_.at(route.back()));
+                data_text.SetPosition(stop_point_.at(route.back()));
 
                 Add(std::move(underlayer_text));
                 Add(std::move(data_text));
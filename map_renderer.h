@@ -1,6 +1,7 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
 #include <deque>
 #include <iostream>
 #include <map>
@@ -13,6 +14,10 @@
 
 namespace map_renderer {
 
+    // Версия отрисовки карты. Увеличивается при любом изменении вида карты,
+    // чтобы карты, сохранённые в базах, отрисовывались заново
+    constexpr uint32_t RENDER_VERSION = 1;
+
     struct MapRendererSettings {
         MapRendererSettings() = default;
 
@@ -0,0 +1,290 @@
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "query_server.h"
+#include "thread_pool.h"
+
+namespace query_server {
+
+    namespace {
+
+        // Количество ответов, которые могут ожидать вывода. Чтение ввода приостанавливается,
+        // пока очередь заполнена, поэтому быстрый ввод не накапливается в памяти
+        constexpr size_t MAX_PENDING_ANSWERS = 1024;
+
+        bool IsBlank(std::string_view line) {
+            return line.find_first_not_of(" \t\r") == std::string_view::npos;
+        }
+
+#if defined(__unix__) || defined(__APPLE__)
+
+        std::system_error SocketError(const char* what) {
+            return std::system_error(errno, std::generic_category(), what);
+        }
+
+        // Функция отправляет данные целиком. Возвращает false, если соединение закрыто
+        bool SendAll(int fd, std::string_view data) {
+            while (!data.empty()) {
+                // MSG_NOSIGNAL не даёт закрытому клиентом соединению завершить процесс сигналом SIGPIPE
+                const ssize_t sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+                if (sent < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (sent <= 0) {
+                    return false;
+                }
+                data.remove_prefix(static_cast<size_t>(sent));
+            }
+            return true;
+        }
+
+        /*
+        * Функция обслуживает одно соединение до его закрытия клиентом.
+        * Все полностью полученные строки выполняются в пуле параллельно,
+        * ответы на них отправляются одним блоком в порядке строк
+        */
+        void ServeConnection(int fd, thread_pool::ThreadPool& pool, const LineHandler& handler) {
+            std::string buffer;
+            std::array<char, 1 << 16> chunk;
+            std::vector<std::future<std::string>> answers;
+            std::string output;
+
+            bool is_open = true;
+            while (is_open) {
+                const ssize_t received = recv(fd, chunk.data(), chunk.size(), 0);
+                if (received < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (received > 0) {
+                    buffer.append(chunk.data(), static_cast<size_t>(received));
+                }
+                else {
+                    // Последняя строка может быть не завершена переводом строки
+                    buffer += '\n';
+                    is_open = false;
+                }
+
+                size_t start = 0;
+                for (size_t end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n', start)) {
+                    std::string line = buffer.substr(start, end - start);
+                    start = end + 1;
+                    if (IsBlank(line)) {
+                        continue;
+                    }
+                    answers.push_back(pool.Submit([&handler, line = std::move(line)] {
+                        return handler(line);
+                    }));
+                }
+                buffer.erase(0, start);
+
+                output.clear();
+                for (std::future<std::string>& answer : answers) {
+                    output += answer.get();
+                    output += '\n';
+                }
+                answers.clear();
+
+                if (!SendAll(fd, output)) {
+                    break;
+                }
+            }
+        }
+
+        /*
+        * Потоки обслуживаемых соединений. Они обращаются к пулу и обработчику по ссылке,
+        * поэтому деструктор прерывает чтение открытых соединений и дожидается всех потоков
+        */
+        class Connections {
+        public:
+            Connections() = default;
+
+            Connections(const Connections&) = delete;
+            Connections& operator= (const Connections&) = delete;
+
+            ~Connections() {
+                std::unique_lock lock(mutex_);
+                for (Connection& connection : connections_) {
+                    if (!connection.is_done) {
+                        // Получив конец ввода, соединение отправляет готовые ответы и завершается
+                        shutdown(connection.fd, SHUT_RDWR);
+                    }
+                }
+                lock.unlock();
+
+                for (Connection& connection : connections_) {
+                    connection.thread.join();
+                }
+            }
+
+            // Запускает обслуживание соединения fd и забирает завершившиеся потоки прежних соединений
+            void Start(int fd, thread_pool::ThreadPool& pool, const LineHandler& handler) {
+                std::lock_guard lock(mutex_);
+                connections_.remove_if([](Connection& connection) {
+                    if (connection.is_done) {
+                        connection.thread.join();
+                    }
+                    return connection.is_done;
+                });
+
+                Connection& connection = connections_.emplace_back();
+                connection.fd = fd;
+                try {
+                    connection.thread = std::thread([this, &connection, &pool, &handler] {
+                        ServeConnection(connection.fd, pool, handler);
+
+                        // Дескриптор закрывается под мьютексом, чтобы деструктор не вызвал
+                        // shutdown для номера, уже выданного другому файлу
+                        std::lock_guard lock(mutex_);
+                        close(connection.fd);
+                        connection.is_done = true;
+                    });
+                }
+                catch (...) {
+                    close(fd);
+                    connections_.pop_back();
+                    throw;
+                }
+            }
+
+        private:
+            struct Connection {
+                int fd = -1;
+                bool is_done = false;
+                std::thread thread;
+            };
+
+            std::mutex mutex_;
+            std::list<Connection> connections_;
+        };
+
+#endif
+
+    } // namespace
+
+    void ServeStream(std::istream& input, std::ostream& output, const LineHandler& handler) {
+        thread_pool::ThreadPool& pool = thread_pool::ThreadPool::Shared();
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::queue<std::future<std::string>> answers;
+        bool is_input_done = false;
+
+        // Ввод читается в отдельном потоке, чтобы готовые ответы выводились, не дожидаясь следующей строки
+        std::thread reader([&] {
+            std::string line;
+            while (std::getline(input, line)) {
+                if (IsBlank(line)) {
+                    continue;
+                }
+
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [&answers] {
+                    return answers.size() < MAX_PENDING_ANSWERS;
+                });
+                answers.push(pool.Submit([&handler, line = std::move(line)] {
+                    return handler(line);
+                }));
+                lock.unlock();
+                condition.notify_all();
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                is_input_done = true;
+            }
+            condition.notify_all();
+        });
+
+        while (true) {
+            std::future<std::string> answer;
+            bool has_more = false;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [&] {
+                    return is_input_done || !answers.empty();
+                });
+                if (answers.empty()) {
+                    break;
+                }
+                answer = std::move(answers.front());
+                answers.pop();
+                has_more = !answers.empty();
+            }
+            condition.notify_all();
+
+            output << answer.get() << '\n';
+            if (!has_more) {
+                output.flush();
+            }
+        }
+
+        reader.join();
+    }
+
+    void ServeSocket(const std::string& path, const LineHandler& handler) {
+#if defined(__unix__) || defined(__APPLE__)
+        sockaddr_un address{};
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Invalid socket path \"" + path + "\"");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.data(), path.size());
+
+        const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) {
+            throw SocketError("socket");
+        }
+
+        unlink(path.c_str());
+        if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            const std::system_error error = SocketError("bind");
+            close(listener);
+            throw error;
+        }
+        if (listen(listener, SOMAXCONN) < 0) {
+            const std::system_error error = SocketError("listen");
+            close(listener);
+            throw error;
+        }
+
+        thread_pool::ThreadPool& pool = thread_pool::ThreadPool::Shared();
+        Connections connections;
+
+        while (true) {
+            const int fd = accept(listener, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                const std::system_error error = SocketError("accept");
+                close(listener);
+                throw error;
+            }
+
+            connections.Start(fd, pool, handler);
+        }
+#else
+        (void)path;
+        (void)handler;
+        throw std::logic_error("Unix domain sockets are not supported on this platform");
+#endif
+    }
+
+} // namespace query_server
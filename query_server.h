@@ -0,0 +1,33 @@
+#pragma once
+
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace query_server {
+
+    // Обработчик одной строки запроса. Возвращает ответ без завершающего перевода строки.
+    // Вызывается из разных потоков одновременно и не должен бросать исключений
+    using LineHandler = std::function<std::string(std::string_view line)>;
+
+    /*
+    * Читает запросы из input построчно и выполняет их в пуле потоков.
+    * Ответы выводятся в output по одному в строке в порядке запросов; поток
+    * сбрасывается, как только готовых ответов не остаётся. Пустые строки пропускаются.
+    * Возвращает управление после окончания ввода и вывода всех ответов
+    */
+    void ServeStream(std::istream& input, std::ostream& output, const LineHandler& handler);
+
+    /*
+    * Принимает соединения на Unix-сокете path. Каждое соединение читается в своём потоке,
+    * запросы из него выполняются в общем пуле потоков, ответы возвращаются в то же
+    * соединение в порядке запросов. Существующий файл path заменяется.
+    * Работает, пока не произойдёт ошибка сокета, и сообщает о ней исключением std::system_error.
+    * Перед этим прерывает чтение открытых соединений и дожидается их потоков, так что
+    * handler не используется после выхода из функции
+    */
+    void ServeSocket(const std::string& path, const LineHandler& handler);
+
+} // namespace query_server
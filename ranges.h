@@ -52,11 +52,13 @@ namespace ranges {
     };
 
     inline auto AsBusRangeDirect(const transport_catalogue::bus_catalogue::Bus* bus) {
-        return BusRange{ bus->route.begin(), bus->route.end(), bus };
+        const auto route = bus->GetRoute();
+        return BusRange{ route.begin(), route.end(), bus };
     }
 
     inline auto AsBusRangeReversed(const transport_catalogue::bus_catalogue::Bus* bus) {
-        return BusRange{ bus->route.rbegin(), bus->route.rend(), bus };
+        const auto route = bus->GetRoute();
+        return BusRange{ route.rbegin(), route.rend(), bus };
     }
 
 }  // namespace ranges
@@ -1,12 +1,20 @@
 #include <algorithm>
 #include <cmath>
+#include <filesystem>
+#include <future>
 #include <iterator>
 #include <stdexcept>
+#include <system_error>
 #include <utility>
 
 #include "request_handler.h"
 #include "geo.h"
+#include "flat_serialization.h"
 #include "serialization.h"
+#include "query_server.h"
+#include "ranges.h"
+#include "sectioned_file.h"
+#include "thread_pool.h"
 
 namespace request_handler {
 
@@ -24,6 +32,9 @@ namespace request_handler {
             else if (argument == "process_requests"sv) {
                 return ProgrammType::PROCESS_REQUESTS;
             }
+            else if (argument == "serve"sv) {
+                return ProgrammType::SERVE;
+            }
             else if (argument == "old_tests") {
                 return ProgrammType::OLD_TESTS;
             }
@@ -32,6 +43,32 @@ namespace request_handler {
         return ProgrammType::UNKNOWN;
     }
 
+    std::optional<ProgrammOptions> ParseProgrammOptions(int argc, const char** argv) {
+        using namespace std::literals;
+
+        ProgrammOptions options;
+        for (int i = 2; i < argc; ++i) {
+            const std::string_view argument(argv[i]);
+            if (argument == "--compact"sv) {
+                options.compact_output = true;
+            }
+            else if (argument == "--jsonl"sv) {
+                options.json_lines = true;
+            }
+            else if (argument == "--socket"sv && i + 1 < argc) {
+                options.socket_path = argv[++i];
+            }
+            else if (argument == "--previous-base"sv && i + 1 < argc) {
+                options.previous_base = argv[++i];
+            }
+            else {
+                return std::nullopt;
+            }
+        }
+
+        return options;
+    }
+
     // ---------- RequestHandler --------------------------------------------------
 
     RequestHandler::RequestHandler(transport_catalogue::TransportCatalogue& catalogue)
@@ -54,18 +91,33 @@ namespace request_handler {
         catalogue_.AddBus(std::move(bus_helper.Build(catalogue_.GetStops())));
     }
 
-    void RequestHandler::RenderMap(MapRendererSettings&& settings) {
+    void RequestHandler::SetMapRenderSettings(MapRendererSettings&& settings) {
         map_render_settings_ = std::move(settings);
+    }
+
+    const std::optional<std::string>& RequestHandler::GetEscapedMap() const {
+        // Отрисовка дорогая и нужна только запросам Map, поэтому выполняется при первом обращении
+        std::call_once(map_render_flag_, [this] {
+            if (map_loader_) {
+                escaped_map_value_ = map_loader_();
+                map_loader_ = nullptr;
+            }
+            if (escaped_map_value_ || !map_render_settings_) {
+                return;
+            }
 
-        MapRenderer render(
-            map_render_settings_.value(),
-            catalogue_.GetStops(),
-            catalogue_.GetBuses());
+            MapRenderer render(
+                map_render_settings_.value(),
+                catalogue_.GetStops(),
+                catalogue_.GetBuses());
 
-        std::ostringstream oss;
-        render.Render(oss);
+            std::ostringstream oss;
+            render.Render(oss);
 
-        map_renderer_value_ = oss.str();
+            // Карта экранируется один раз, ответы на запросы Map копируют её без изменений
+            escaped_map_value_ = json::EscapeString(oss.str());
+        });
+        return escaped_map_value_;
     }
 
     bool RequestHandler::IsRouteValid(
@@ -81,13 +133,15 @@ namespace request_handler {
                 return false;
             }
 
-            auto it_from = std::find(bus->route.rbegin(), bus->route.rend(), from);
-            if (it_from == bus->route.rend()) {
+            const auto route = bus->GetRoute();
+
+            auto it_from = std::find(route.rbegin(), route.rend(), from);
+            if (it_from == route.rend()) {
                 return false;
             }
 
-            auto it_to = std::find(bus->route.rbegin(), bus->route.rend(), to);
-            if (it_to == bus->route.rend()) {
+            auto it_to = std::find(route.rbegin(), route.rend(), to);
+            if (it_to == route.rend()) {
                 return false;
             }
         }
@@ -113,13 +167,33 @@ namespace request_handler {
     void RequestHandler::InitRouter() const {
         using namespace transport_graph;
 
-        if (!graph_) {
-            graph_ = std::make_unique<TransportGraph>(catalogue_);
-        }
+        // Запросы Route могут выполняться параллельно, граф и роутер строятся один раз
+        std::call_once(router_init_flag_, [this] {
+            if (!graph_ && graph_loader_) {
+                std::future<graph::Router<TransportTime>::RoutesInternalData> routes;
+                if (routes_loader_) {
+                    routes = std::async(
+                        thread_pool::ThreadPool::DefaultThreadCount() > 1 ? std::launch::async : std::launch::deferred,
+                        routes_loader_);
+                }
+                graph_ = std::make_unique<TransportGraph>(graph_loader_());
+                if (routes.valid()) {
+                    router_ = std::make_unique<TransportRouter>(TransportRouterCreator::Build(
+                        *graph_, graph::RouterCreator<TransportTime>::Build(graph_->GetGraph(), routes.get())));
+                }
+            }
+            // Загрузчики больше не нужны и могут удерживать данные базы
+            graph_loader_ = nullptr;
+            routes_loader_ = nullptr;
 
-        if (!router_) {
-            router_ = std::make_unique<TransportRouter>(*graph_);
-        }
+            if (!graph_) {
+                graph_ = std::make_unique<TransportGraph>(catalogue_);
+            }
+
+            if (!router_) {
+                router_ = std::make_unique<TransportRouter>(*graph_);
+            }
+        });
     }
 
     std::vector<const transport_catalogue::stop_catalogue::Stop*> RequestHandler::GetStops() const {
@@ -142,18 +216,77 @@ namespace request_handler {
         return buses;
     }
 
+    uint64_t RequestHandler::GetRoutingFingerprint() const {
+        std::string data;
+        auto append = [&data](auto value) {
+            data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        };
+
+        const auto& settings = GetRouteSettings();
+        append(settings.bus_velocity);
+        append(static_cast<int64_t>(settings.bus_wait_time));
+        auto append_name = [&data, &append](std::string_view name) {
+            append(static_cast<uint64_t>(name.size()));
+            data.append(name);
+        };
+
+        // Вершины графа нумеруются в порядке обхода индекса по именам, а из равных по времени
+        // рёбер остаётся первое в порядке обхода автобусов (см. TransportGraph). Этот порядок
+        // определяется именами и очерёдностью их добавления, поэтому имена входят в отпечаток по номерам
+        const auto& stops = catalogue_.GetStops();
+        append(static_cast<uint64_t>(stops.Size()));
+        for (size_t id = 0; id < stops.Size(); ++id) {
+            auto stop = stops.At(id);
+            append_name(stop ? (*stop)->GetName() : std::string_view{});
+        }
+
+        // Автобусы перебираются по номерам, чтобы отпечаток не зависел от порядка хранения
+        std::vector<const transport_catalogue::bus_catalogue::Bus*> buses = GetBuses();
+        std::sort(buses.begin(), buses.end(), [this](const auto* lhs, const auto* rhs) {
+            return GetId(lhs) < GetId(rhs);
+        });
+
+        const auto& distances = catalogue_.GetStops().GetDistances();
+        auto append_distances = [&append, &distances](const auto& range) {
+            for (auto it = range.begin(); it != range.end() && std::next(it) != range.end(); ++it) {
+                auto distance = distances.find({ *it, *std::next(it) });
+                append(distance != distances.end() ? distance->second : -1.0);
+            }
+        };
+
+        for (const auto* bus : buses) {
+            append(static_cast<uint64_t>(GetId(bus)));
+            const auto route = bus->GetRoute();
+            append_name(bus->GetName());
+            append(static_cast<int32_t>(bus->GetRouteType()));
+            append(static_cast<uint64_t>(route.size()));
+            for (const auto* stop : route) {
+                append(static_cast<uint64_t>(GetId(stop)));
+            }
+            append_distances(ranges::AsBusRangeDirect(bus));
+            if (bus->GetRouteType() == transport_catalogue::RouteType::BackAndForth) {
+                append_distances(ranges::AsBusRangeReversed(bus));
+            }
+        }
+
+        return sectioned_file::Fingerprint(data);
+    }
+
     namespace detail_base {
 
         void RequestBaseStopProcess(
-            RequestHandler& request_handler,
+            transport_catalogue::TransportCatalogueBuilder& builder,
             const json::Node* node) {
             using namespace std::literals;
 
             const json::Dict& request = node->AsMap();
+            std::string_view name = request.at("name"sv).AsString();
 
-            std::string name = request.at("name"s).AsString();
+            builder.AddStop(name, Coordinates{ request.at("latitude"sv).AsDouble(), request.at("longitude"sv).AsDouble() });
 
-            request_handler.AddStop(std::move(name), Coordinates{ request.at("latitude"s).AsDouble(), request.at("longitude"s).AsDouble() });
+            for (const auto& [name_to, distance] : request.at("road_distances"sv).AsMap()) {
+                builder.AddDistance(name, name_to, distance.AsDouble());
+            }
         }
 
         RouteSettings CreateRouteSettings(const std::unordered_map<std::string_view, const json::Node*> input_route_settings) {
@@ -169,31 +302,406 @@ namespace request_handler {
             return settings;
         }
 
-        transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::Node* node) {
+        void RequestBaseBusProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            const json::Node* node) {
             using namespace std::literals;
-            using namespace bus_catalogue;
 
             const json::Dict& request = node->AsMap();
 
-            std::string name = request.at("name"s).AsString();
+            std::string name(request.at("name"sv).AsString());
 
-            transport_catalogue::RouteType type = (request.at("is_roundtrip"s).AsBool())
+            transport_catalogue::RouteType type = (request.at("is_roundtrip"sv).AsBool())
                 ? transport_catalogue::RouteType::Round
                 : transport_catalogue::RouteType::BackAndForth;
 
+            const json::Array& stops = request.at("stops"sv).AsArray();
+
             std::vector<std::string_view> route;
-            for (const json::Node& node_stops : request.at("stops"s).AsArray()) {
+            route.reserve(stops.size());
+            for (const json::Node& node_stops : stops) {
                 route.push_back(node_stops.AsString());
             }
 
-            return BusHelper().SetName(std::move(name)).SetStopNames(std::move(route)).SetRouteType(type);
+            builder.AddBus(std::move(name), type, route);
+        }
+
+        void RequestBaseProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            const json::Node& node) {
+            using namespace std::literals;
+
+            std::string_view type = node.AsMap().at("type"sv).AsString();
+            if (type == "Stop"sv) {
+                RequestBaseStopProcess(builder, &node);
+            }
+            else if (type == "Bus"sv) {
+                RequestBaseBusProcess(builder, &node);
+            }
+            else {
+                throw json::ParsingError("Unknown type \""s + std::string(type) + "\""s);
+            }
+        }
+
+        // Запросы base_requests декодируются параллельно, если их не меньше этого количества
+        static constexpr size_t PARALLEL_MIN_REQUESTS = 4096;
+
+        // Количество запросов, декодируемых одной задачей пула потоков
+        static constexpr size_t PARALLEL_BATCH_SIZE = 256;
+
+        /*
+        * Обработчик событий разбора одного запроса Stop или Bus.
+        * Заполняет поля запроса напрямую, без промежуточных json::Node. Как и в json::Dict,
+        * из повторяющихся ключей учитывается первый, значения неизвестных ключей пропускаются.
+        * Если структура запроса отличается от ожидаемой, разбор помечается неудачным
+        */
+        class BaseRequestDecoder final : public json::SaxHandler {
+        public:
+            void Null() override {
+                if (!Skip(0)) {
+                    Fail();
+                }
+            }
+
+            void Bool(bool value) override {
+                if (Skip(0)) {
+                    return;
+                }
+                if (level_ == Level::REQUEST && field_ == Field::IS_ROUNDTRIP) {
+                    is_roundtrip_ = value;
+                    field_ = Field::NONE;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void Int(int value) override {
+                Number(value);
+            }
+
+            void Double(double value) override {
+                Number(value);
+            }
+
+            void String(std::string&&) override {
+                // Строки с экранированными символами не ссылаются на буфер и разбираются обычным образом
+                if (!Skip(0)) {
+                    Fail();
+                }
+            }
+
+            void StringView(std::string_view value) override {
+                if (Skip(0)) {
+                    return;
+                }
+                if (level_ == Level::STOPS) {
+                    stops_.push_back(value);
+                }
+                else if (level_ == Level::REQUEST && field_ == Field::TYPE) {
+                    type_ = value;
+                    field_ = Field::NONE;
+                }
+                else if (level_ == Level::REQUEST && field_ == Field::NAME) {
+                    name_ = value;
+                    field_ = Field::NONE;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void Key(std::string&& key) override {
+                if (is_failed_ || skip_depth_ > 0) {
+                    return;
+                }
+                if (level_ == Level::REQUEST) {
+                    SelectField(key);
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void KeyView(std::string_view key) override {
+                if (is_failed_ || skip_depth_ > 0) {
+                    return;
+                }
+                if (level_ == Level::REQUEST) {
+                    SelectField(key);
+                }
+                else if (level_ == Level::DISTANCES) {
+                    distance_to_ = key;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void StartArray() override {
+                if (Skip(1)) {
+                    return;
+                }
+                if (level_ == Level::REQUEST && field_ == Field::STOPS) {
+                    level_ = Level::STOPS;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void EndArray() override {
+                if (Skip(-1)) {
+                    return;
+                }
+                if (level_ == Level::STOPS) {
+                    level_ = Level::REQUEST;
+                    field_ = Field::NONE;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void StartDict() override {
+                if (Skip(1)) {
+                    return;
+                }
+                if (level_ == Level::NONE) {
+                    level_ = Level::REQUEST;
+                }
+                else if (level_ == Level::REQUEST && field_ == Field::ROAD_DISTANCES) {
+                    level_ = Level::DISTANCES;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            void EndDict() override {
+                if (Skip(-1)) {
+                    return;
+                }
+                if (level_ == Level::DISTANCES) {
+                    level_ = Level::REQUEST;
+                    field_ = Field::NONE;
+                }
+                else if (level_ == Level::REQUEST) {
+                    level_ = Level::DONE;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+            // Возвращает разобранный запрос или std::nullopt, если структура запроса отличается от ожидаемой
+            std::optional<BaseRequest> Extract() {
+                using namespace std::literals;
+
+                if (is_failed_ || level_ != Level::DONE) {
+                    return std::nullopt;
+                }
+
+                if (type_ == "Stop"sv && Has(Field::NAME) && Has(Field::LATITUDE) && Has(Field::LONGITUDE) && Has(Field::ROAD_DISTANCES)) {
+                    // Расстояния передаются в порядке обхода json::Dict: по возрастанию имени, без повторов
+                    std::stable_sort(road_distances_.begin(), road_distances_.end(),
+                        [](const auto& lhs, const auto& rhs) {
+                            return lhs.first < rhs.first;
+                        });
+                    road_distances_.erase(std::unique(road_distances_.begin(), road_distances_.end(),
+                        [](const auto& lhs, const auto& rhs) {
+                            return lhs.first == rhs.first;
+                        }), road_distances_.end());
+                    return StopRequest{ name_, Coordinates{ latitude_, longitude_ }, std::move(road_distances_) };
+                }
+                if (type_ == "Bus"sv && Has(Field::NAME) && Has(Field::IS_ROUNDTRIP) && Has(Field::STOPS)) {
+                    return BusRequest{ name_, is_roundtrip_, std::move(stops_) };
+                }
+                return std::nullopt;
+            }
+
+        private:
+            enum class Level {
+                NONE,
+                REQUEST,
+                DISTANCES,
+                STOPS,
+                DONE
+            };
+
+            enum class Field {
+                TYPE,
+                NAME,
+                LATITUDE,
+                LONGITUDE,
+                ROAD_DISTANCES,
+                STOPS,
+                IS_ROUNDTRIP,
+                NONE,
+                SKIP
+            };
+
+            void Fail() {
+                is_failed_ = true;
+            }
+
+            bool Has(Field field) const {
+                return (seen_ & (1u << static_cast<unsigned>(field))) != 0;
+            }
+
+            void SelectField(std::string_view key) {
+                using namespace std::literals;
+
+                static constexpr std::pair<std::string_view, Field> fields[] = {
+                    { "type"sv, Field::TYPE },
+                    { "name"sv, Field::NAME },
+                    { "latitude"sv, Field::LATITUDE },
+                    { "longitude"sv, Field::LONGITUDE },
+                    { "road_distances"sv, Field::ROAD_DISTANCES },
+                    { "stops"sv, Field::STOPS },
+                    { "is_roundtrip"sv, Field::IS_ROUNDTRIP }
+                };
+
+                field_ = Field::SKIP;
+                for (const auto& [name, field] : fields) {
+                    if (key == name) {
+                        field_ = Has(field) ? Field::SKIP : field;
+                        seen_ |= 1u << static_cast<unsigned>(field);
+                        break;
+                    }
+                }
+            }
+
+            // Пропускает значение неизвестного или повторного ключа и всё после неудачи.
+            // nesting - изменение вложенности: 1 для начала массива или словаря, -1 для конца
+            bool Skip(int nesting) {
+                if (is_failed_) {
+                    return true;
+                }
+                if (skip_depth_ == 0 && field_ != Field::SKIP) {
+                    return false;
+                }
+                skip_depth_ += nesting;
+                if (skip_depth_ == 0) {
+                    field_ = Field::NONE;
+                }
+                return true;
+            }
+
+            void Number(double value) {
+                if (Skip(0)) {
+                    return;
+                }
+                if (level_ == Level::DISTANCES) {
+                    road_distances_.emplace_back(distance_to_, value);
+                }
+                else if (level_ == Level::REQUEST && field_ == Field::LATITUDE) {
+                    latitude_ = value;
+                    field_ = Field::NONE;
+                }
+                else if (level_ == Level::REQUEST && field_ == Field::LONGITUDE) {
+                    longitude_ = value;
+                    field_ = Field::NONE;
+                }
+                else {
+                    Fail();
+                }
+            }
+
+        private:
+            Level level_ = Level::NONE;
+            Field field_ = Field::NONE;
+            int skip_depth_ = 0;
+            unsigned seen_ = 0;
+            bool is_failed_ = false;
+
+            std::string_view type_;
+            std::string_view name_;
+            double latitude_ = 0.0;
+            double longitude_ = 0.0;
+            std::string_view distance_to_;
+            std::vector<std::pair<std::string_view, double>> road_distances_;
+            bool is_roundtrip_ = false;
+            std::vector<std::string_view> stops_;
+        };
+
+        std::optional<BaseRequest> DecodeBaseRequest(std::string_view item) {
+            try {
+                BaseRequestDecoder decoder;
+                if (json::LoadSax(item, decoder, json::StringStorage::VIEW) == item.size()) {
+                    if (auto request = decoder.Extract()) {
+                        return request;
+                    }
+                }
+            }
+            catch (const json::ParsingError&) {
+                return std::nullopt;
+            }
+
+            // Запрос другой структуры разбирается в json::Node
+            if (auto node = json::LoadExact(item, json::StringStorage::VIEW)) {
+                return BaseRequest(std::move(*node));
+            }
+            return std::nullopt;
+        }
+
+        void RequestBaseDecodedProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            BaseRequest&& request) {
+            if (const auto* stop = std::get_if<StopRequest>(&request)) {
+                builder.AddStop(stop->name, stop->coordinates);
+                const auto from = builder.GetStopNameId(stop->name);
+                for (const auto& [name_to, distance] : stop->road_distances) {
+                    builder.AddDistance(from, builder.GetStopNameId(name_to), distance);
+                }
+            }
+            else if (const auto* bus = std::get_if<BusRequest>(&request)) {
+                std::vector<transport_catalogue::TransportCatalogueBuilder::NameId> stop_ids;
+                stop_ids.reserve(bus->stops.size());
+                for (std::string_view stop : bus->stops) {
+                    stop_ids.push_back(builder.GetStopNameId(stop));
+                }
+                builder.AddBus(std::string(bus->name),
+                    bus->is_roundtrip ? transport_catalogue::RouteType::Round : transport_catalogue::RouteType::BackAndForth,
+                    std::move(stop_ids));
+            }
+            else {
+                RequestBaseProcess(builder, std::get<json::Node>(request));
+            }
+        }
+
+        size_t RequestBaseTextsProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            const std::vector<std::string_view>& items) {
+            // Запрос, который не удалось разобрать, и все следующие за ним разбираются обычным образом
+            auto consume = [&builder](std::optional<BaseRequest>&& request) {
+                if (!request) {
+                    return false;
+                }
+                RequestBaseDecodedProcess(builder, std::move(*request));
+                return true;
+            };
+
+            if (items.size() >= PARALLEL_MIN_REQUESTS && thread_pool::ThreadPool::DefaultThreadCount() > 1) {
+                return thread_pool::ForEachOrdered(items.size(), PARALLEL_BATCH_SIZE,
+                    [&items](size_t i) {
+                        return DecodeBaseRequest(items[i]);
+                    },
+                    consume);
+            }
+
+            size_t processed = 0;
+            while (processed < items.size() && consume(DecodeBaseRequest(items[processed]))) {
+                ++processed;
+            }
+            return processed;
         }
 
         svg::Color ParseColor(const json::Node* node) {
             using namespace std::string_literals;
 
             if (node->IsString()) {
-                return svg::Color(node->AsString());
+                return svg::Color(std::string(node->AsString()));
             }
             else if (node->IsArray()) {
                 const json::Array& array_color = node->AsArray();
@@ -244,7 +752,7 @@ namespace request_handler {
             settings.underlayer_width = render_settings.at("underlayer_width"sv)->AsDouble();
             settings.color_palette = std::move(ParsePaletteColors(render_settings.at("color_palette"sv)->AsArray()));
 
-            request_handler.RenderMap(std::move(settings));
+            request_handler.SetMapRenderSettings(std::move(settings));
         }
 
     } // namespace detail_base
@@ -252,105 +760,105 @@ namespace request_handler {
     namespace detail_stat {
 
         void RequestStatStopProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request) {
             using namespace std::literals;
             using namespace transport_catalogue::stop_catalogue;
 
-            std::string_view name = request.at("name"s).AsString();
-            int id = request.at("id"s).AsInt();
+            std::string_view name = request.at("name"sv).AsString();
+            int id = request.at("id"sv).AsInt();
 
             if (request_handler.DoesStopExist(name)) {
-                json::Array buses_arr;
+                writer
+                    .StartDict()
+                    .Key("buses"sv).StartArray();
                 for (const std::string_view bus : request_handler.GetStopBuses(name)) {
-                    buses_arr.push_back(std::string(bus));
+                    writer.Value(bus);
                 }
-
-                builder
-                    .StartDict()
-                    .Key("buses"s).Value(std::move(buses_arr))
-                    .Key("request_id"s).Value(id)
+                writer
+                    .EndArray()
+                    .Key("request_id"sv).Value(id)
                     .EndDict();
             }
             else {
-                builder
+                writer
                     .StartDict()
-                    .Key("error_message"s).Value("not found"s)
-                    .Key("request_id"s).Value(id)
+                    .Key("error_message"sv).Value("not found"sv)
+                    .Key("request_id"sv).Value(id)
                     .EndDict();
             }
         }
 
         void RequestStatBusProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request) {
             using namespace std::literals;
 
-            std::string_view name = request.at("name"s).AsString();
-            int id = request.at("id"s).AsInt();
+            std::string_view name = request.at("name"sv).AsString();
+            int id = request.at("id"sv).AsInt();
 
             const auto opt_bus = request_handler.GetBus(name);
 
             if (opt_bus) {
                 const transport_catalogue::bus_catalogue::Bus* bus = *opt_bus;
-                double curvature = (std::abs(bus->route_geo_length) > 1e-6) ? bus->route_true_length / bus->route_geo_length : 0.0;
+                double curvature = (std::abs(bus->GetRouteGeoLength()) > 1e-6) ? bus->GetRouteTrueLength() / bus->GetRouteGeoLength() : 0.0;
 
-                builder
+                writer
                     .StartDict()
-                    .Key("curvature"s).Value(curvature)
-                    .Key("request_id"s).Value(id)
-                    .Key("route_length"s).Value(bus->route_true_length)
-                    .Key("stop_count"s).Value(static_cast<int>(bus->stops_on_route))
-                    .Key("unique_stop_count"s).Value(static_cast<int>(bus->unique_stops))
+                    .Key("curvature"sv).Value(curvature)
+                    .Key("request_id"sv).Value(id)
+                    .Key("route_length"sv).Value(bus->GetRouteTrueLength())
+                    .Key("stop_count"sv).Value(static_cast<int>(bus->GetStopsOnRoute()))
+                    .Key("unique_stop_count"sv).Value(static_cast<int>(bus->GetUniqueStops()))
                     .EndDict();
             }
             else {
-                builder
+                writer
                     .StartDict()
-                    .Key("error_message"s).Value("not found"s)
-                    .Key("request_id"s).Value(id)
+                    .Key("error_message"sv).Value("not found"sv)
+                    .Key("request_id"sv).Value(id)
                     .EndDict();
             }
         }
 
         void RequestMapProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request) {
             using namespace std::literals;
 
-            if (!request_handler.GetMap()) {
+            if (!request_handler.GetEscapedMap()) {
                 throw std::logic_error("Map hasn't been rendered!"s);
             }
 
-            int id = request.at("id"s).AsInt();
+            int id = request.at("id"sv).AsInt();
 
-            builder
+            writer
                 .StartDict()
-                .Key("map"s).Value(*request_handler.GetMap())
-                .Key("request_id"s).Value(id)
+                .Key("map"sv).RawValue(*request_handler.GetEscapedMap())
+                .Key("request_id"sv).Value(id)
                 .EndDict();
         }
 
         void RequestRouteProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request) {
             using namespace std::literals;
 
-            std::string_view name_from = request.at("from"s).AsString();
-            std::string_view name_to = request.at("to"s).AsString();
+            std::string_view name_from = request.at("from"sv).AsString();
+            std::string_view name_to = request.at("to"sv).AsString();
 
-            int id = request.at("id"s).AsInt();
+            int id = request.at("id"sv).AsInt();
 
             const auto route_data = request_handler.GetRoute(name_from, name_to);
 
             if (route_data) {
                 double check_total_time = 0.0;
-                builder.StartDict()
-                    .Key("items"s)
+                writer.StartDict()
+                    .Key("items"sv)
                     .StartArray();
                 
                 for (const auto& [from, to, bus, span, time] : route_data->route) {
@@ -358,66 +866,134 @@ namespace request_handler {
                     check_total_time += time;
 
                     if (from == to) {
-                        builder.StartDict()
-                            .Key("stop_name"s).Value(from->name)
-                            .Key("time"s).Value(time)
-                            .Key("type"s).Value("Wait"s)
+                        writer.StartDict()
+                            .Key("stop_name"sv).Value(from->GetName())
+                            .Key("time"sv).Value(time)
+                            .Key("type"sv).Value("Wait"sv)
                             .EndDict();
                     }
                     else {
-                        builder.StartDict()
-                            .Key("bus"s).Value(bus->name)
-                            .Key("span_count"s).Value(span)
-                            .Key("time"s).Value(time)
-                            .Key("type"s).Value("Bus"s)
+                        writer.StartDict()
+                            .Key("bus"sv).Value(bus->GetName())
+                            .Key("span_count"sv).Value(span)
+                            .Key("time"sv).Value(time)
+                            .Key("type"sv).Value("Bus"sv)
                             .EndDict();
                     }
                 }
                 assert(std::abs(check_total_time - route_data->time) < 1e-6);
                 
-                builder.EndArray()
-                    .Key("request_id"s).Value(id)
-                    .Key("total_time"s).Value(route_data->time)
+                writer.EndArray()
+                    .Key("request_id"sv).Value(id)
+                    .Key("total_time"sv).Value(route_data->time)
                     .EndDict();
             }
             else {
-                builder
+                writer
                     .StartDict()
-                    .Key("error_message"s).Value("not found"s)
-                    .Key("request_id"s).Value(id)
+                    .Key("error_message"sv).Value("not found"sv)
+                    .Key("request_id"sv).Value(id)
                     .EndDict();
             }
         }
 
         void RequestStatProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Node* node) {
             using namespace std::literals;
 
             const json::Dict& request = node->AsMap();
-            std::string_view type = request.at("type"s).AsString();
+            std::string_view type = request.at("type"sv).AsString();
 
             if (type == "Stop"sv) {
-                RequestStatStopProcess(builder, request_handler, request);
+                RequestStatStopProcess(writer, request_handler, request);
             }
             else if (type == "Bus"sv) {
-                RequestStatBusProcess(builder, request_handler, request);
+                RequestStatBusProcess(writer, request_handler, request);
             }
             else if (type == "Map"sv) {
-                RequestMapProcess(builder, request_handler, request);
+                RequestMapProcess(writer, request_handler, request);
             }
             else if (type == "Route"sv) {
-                RequestRouteProcess(builder, request_handler, request);
+                RequestRouteProcess(writer, request_handler, request);
             }
             else {
                 throw json::ParsingError("Unknown type "s + std::string(type) + " in RequestStatProcess"s);
             }
         }
 
+        std::string RequestStatItemProcess(
+            const json::Writer& writer,
+            const RequestHandler& request_handler,
+            const json::Node* node) {
+            json::Writer item = writer.MakeItemWriter();
+            RequestStatProcess(item, request_handler, node);
+            return item.Extract();
+        }
+
+        // Запросы stat_requests выполняются параллельно, если их не меньше этого количества
+        static constexpr size_t PARALLEL_MIN_REQUESTS = 1024;
+
+        // Количество запросов, выполняемых одной задачей пула потоков
+        static constexpr size_t PARALLEL_BATCH_SIZE = 64;
+
+        static bool IsParallel(size_t request_count) {
+            return request_count >= PARALLEL_MIN_REQUESTS && thread_pool::ThreadPool::DefaultThreadCount() > 1;
+        }
+
+        void RequestStatListProcess(
+            json::Writer& writer,
+            const RequestHandler& request_handler,
+            const std::vector<const json::Node*>& nodes) {
+            if (!IsParallel(nodes.size())) {
+                for (const json::Node* node : nodes) {
+                    RequestStatProcess(writer, request_handler, node);
+                }
+                return;
+            }
+
+            // Ответы готовятся в отдельных буферах и дописываются в writer в порядке запросов
+            thread_pool::ForEachOrdered(nodes.size(), PARALLEL_BATCH_SIZE,
+                [&](size_t i) {
+                    return RequestStatItemProcess(writer, request_handler, nodes[i]);
+                },
+                [&writer](std::string&& answer) {
+                    writer.RawValue(answer);
+                    return true;
+                });
+        }
+
+        size_t RequestStatTextsProcess(
+            json::Writer& writer,
+            const RequestHandler& request_handler,
+            const std::vector<std::string_view>& items) {
+            if (!IsParallel(items.size())) {
+                return 0;
+            }
+
+            // Запрос, который не удалось разобрать, и все следующие за ним разбираются обычным образом
+            return thread_pool::ForEachOrdered(items.size(), PARALLEL_BATCH_SIZE,
+                [&](size_t i) -> std::optional<std::string> {
+                    std::optional<json::Node> node = json::LoadExact(items[i], json::StringStorage::VIEW);
+                    if (!node) {
+                        return std::nullopt;
+                    }
+                    return RequestStatItemProcess(writer, request_handler, &*node);
+                },
+                [&writer](std::optional<std::string>&& answer) {
+                    if (!answer) {
+                        return false;
+                    }
+                    writer.RawValue(*answer);
+                    return true;
+                });
+        }
+
     } // namespace detail_stat
 
     void RequestHandlerProcess::RunOldTests() {
+        ReadInput();
         ExecuteBaseProcess();
         ExecuteStatProcess();
     }
@@ -425,81 +1001,265 @@ namespace request_handler {
     void RequestHandlerProcess::ExecuteMakeBaseRequests() {
         using namespace std::literals;
 
+        ReadInput();
         ExecuteBaseProcess();
 
+        const auto& settings = reader_->SerializationSettings();
+        const std::string file(settings.at("file"sv)->AsString());
+        auto format_setting = settings.find("format"sv);
+        const std::string format(format_setting != settings.end() ? format_setting->second->AsString() : "protobuf"sv);
+
+        // Формат "flat" загружается быстрее, по умолчанию база записывается в protobuf
+        if (format != "flat"sv && format != "protobuf"sv) {
+            throw std::logic_error("Unknown serialization format \""s + format + "\""s);
+        }
+
+        // Каталог и настройки уже скопированы из документа, поэтому входной буфер освобождается
+        // до построения роутера и записи базы, и память не удерживается размером входных данных
+        reader_.reset();
+
+        // Построение роутера - самая долгая часть make_base. Если прежняя база построена по тем же
+        // остановкам, маршрутам, расстояниям и настройкам маршрута, граф и роутер берутся из неё
+        ReuseRouter(options_.previous_base.empty() ? file : options_.previous_base);
         handler_.InitRouter();
 
-        std::ofstream out(
-            reader_.SerializationSettings().at("file"sv)->AsString(),
-            std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+        // База пишется во временный файл рядом с целевым и переименовывается поверх него.
+        // Процессы, уже открывшие или отобразившие прежнюю базу, продолжают читать неизменённый файл
+        const std::string temp_file = file + ".tmp"s;
+        try {
+            {
+                std::ofstream out(temp_file, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+                if (!out) {
+                    throw std::logic_error("Couldn't create base file \""s + temp_file + "\""s);
+                }
+                if (format == "flat"sv) {
+                    flat_serialization::Serialize(out, handler_);
+                }
+                else {
+                    transport_serialization::Serialize(out, handler_);
+                }
+                out.close();
+                if (!out) {
+                    throw std::logic_error("Couldn't write base file \""s + temp_file + "\""s);
+                }
+            }
 
-        transport_serialization::Serialize(out, handler_);
+            std::error_code error;
+            std::filesystem::rename(temp_file, file, error);
+            if (error) {
+                throw std::logic_error("Couldn't replace base file \""s + file + "\": "s + error.message());
+            }
+        }
+        catch (...) {
+            std::error_code error;
+            std::filesystem::remove(temp_file, error);
+            throw;
+        }
     }
 
     void RequestHandlerProcess::ExecuteProcessRequests() {
         using namespace std::literals;
 
-        std::ifstream in(
-            reader_.SerializationSettings().at("file"sv)->AsString(),
-            std::ofstream::in | std::ofstream::binary);
+        // Формат вывода может задаваться в serialization_settings,
+        // поэтому вывод начинается только после загрузки базы
+        std::optional<json::Writer> writer;
+        auto load_base = [&](std::string_view file, const json::Node* compact_output) {
+            LoadBase(file);
+            writer.emplace(output_, options_.compact_output || (compact_output && compact_output->AsBool()));
+            writer->StartArray();
+        };
+
+        // Запросы, пришедшие раньше настроек сериализации, ждут загрузки базы
+        std::vector<json::Node> pending;
+
+        // Загружает базу, если настройки сериализации уже разобраны. Возвращает false, если их ещё нет
+        auto try_load_base = [&](const json::Dict& root) {
+            if (writer) {
+                return true;
+            }
+            auto settings = root.find("serialization_settings"sv);
+            if (settings == root.end()) {
+                return false;
+            }
+            const json::Dict& settings_dict = settings->second.AsMap();
+            auto compact_output = settings_dict.find("compact_output"sv);
+            load_base(settings_dict.at("file"sv).AsString(),
+                compact_output != settings_dict.end() ? &compact_output->second : nullptr);
+            return true;
+        };
+
+        ReadInput(json::StreamedArray{
+            [&](json::Node&& node, const json::Dict& root) {
+                if (!try_load_base(root)) {
+                    pending.push_back(std::move(node));
+                    return;
+                }
+                detail_stat::RequestStatProcess(*writer, handler_, &node);
+            },
+            [&](const std::vector<std::string_view>& items, const json::Dict& root) -> size_t {
+                if (!try_load_base(root)) {
+                    return 0;
+                }
+                return detail_stat::RequestStatTextsProcess(*writer, handler_, items);
+            } });
+
+        if (!writer) {
+            const auto& settings = reader_->SerializationSettings();
+            auto compact_output = settings.find("compact_output"sv);
+            load_base(settings.at("file"sv)->AsString(),
+                compact_output != settings.end() ? compact_output->second : nullptr);
+        }
+        for (const json::Node& node : pending) {
+            detail_stat::RequestStatProcess(*writer, handler_, &node);
+        }
 
-        transport_serialization::Deserialize(handler_, in);
+        writer->EndArray();
+    }
 
-        ExecuteStatProcess();
+    void RequestHandlerProcess::ExecuteProcessRequestLines() {
+        if (!LoadBaseFromSettingsLine()) {
+            return;
+        }
+
+        // Ответы выводятся компактными строками; writer задаёт только их формат и сам ничего не пишет
+        const json::Writer format(output_, true);
+        query_server::ServeStream(input_, output_, [this, &format](std::string_view line) {
+            return AnswerRequestLine(format, line);
+        });
     }
 
-    void RequestHandlerProcess::ExecuteBaseProcess() {
-        {
-            // Добавляемые остановки
-            for (const json::Node* node : reader_.StopRequests()) {
-                detail_base::RequestBaseStopProcess(handler_, node);
-            }
+    void RequestHandlerProcess::ExecuteServe() {
+        // Без сокета serve читает стандартный ввод по тому же протоколу, что и process_requests --jsonl
+        if (options_.socket_path.empty()) {
+            ExecuteProcessRequestLines();
+            return;
         }
 
-        {
-            // Добавляемые реальные расстояния между остановками
-            for (const auto& [name_from, distances] : reader_.RoadDistances()) {
-                for (const auto& [name_to, distance] : *distances) {
-                    handler_.AddDistance(name_from, name_to, distance.AsDouble());
+        if (!LoadBaseFromSettingsLine()) {
+            return;
+        }
+
+        const json::Writer format(output_, true);
+        query_server::ServeSocket(options_.socket_path, [this, &format](std::string_view line) {
+            return AnswerRequestLine(format, line);
+        });
+    }
+
+    std::string RequestHandlerProcess::AnswerRequestLine(const json::Writer& format, std::string_view line) const {
+        using namespace std::literals;
+
+        // Ошибка в запросе не прерывает обработку, а возвращается вместо ответа
+        std::optional<json::Node> request;
+        try {
+            request = json::LoadExact(line, json::StringStorage::VIEW);
+            if (!request) {
+                throw json::ParsingError("Invalid JSON request"s);
+            }
+            return detail_stat::RequestStatItemProcess(format, handler_, &*request);
+        }
+        catch (const std::exception& e) {
+            // Ключи выводятся в том же порядке, что и в ответе "not found": request_id последним
+            json::Writer error = format.MakeItemWriter();
+            error.StartDict().Key("error_message"sv).Value(e.what());
+            if (request && request->IsMap()) {
+                if (auto id = request->AsMap().find("id"sv); id != request->AsMap().end() && id->second.IsInt()) {
+                    error.Key("request_id"sv).Value(id->second.AsInt());
                 }
             }
+            error.EndDict();
+            return error.Extract();
         }
+    }
 
-        {
-            // Создаём переменную с настройками маршрута
-            catalogue_.SetBusRouteCommonSettings(detail_base::CreateRouteSettings(reader_.RoutingSettings()));
+    bool RequestHandlerProcess::IsBlankLine(std::string_view line) {
+        using namespace std::literals;
 
-            // Добавляемые автобусные маршруты
-            for (const json::Node* node : reader_.BusRequests()) {
-                bus_catalogue::BusHelper helper = detail_base::RequestBaseBusProcess(node);
-                handler_.AddBus(std::move(helper));
-            }
+        return line.find_first_not_of(" \t\r"sv) == std::string_view::npos;
+    }
+
+    bool RequestHandlerProcess::LoadBaseFromSettingsLine() {
+        using namespace std::literals;
+
+        std::string line;
+        while (std::getline(input_, line) && IsBlankLine(line)) {
+        }
+        if (!input_) {
+            return false;
         }
 
-        {
-            // Инициализируем карту маршрутов
-            if (!reader_.RenderSettings().empty()) {
-                detail_base::RequestBaseMapProcess(handler_, reader_.RenderSettings());
-            }
+        const json::Document settings = json::Load(std::string_view(line));
+        LoadBase(settings.GetRoot().AsMap().at("serialization_settings"sv).AsMap().at("file"sv).AsString());
+
+        // Процесс отвечает на запросы долго, а файл базы за это время может быть заменён новым.
+        // Граф, роутер и карта загружаются сразу, и после этого файл базы больше не читается
+        handler_.InitRouter();
+        handler_.GetEscapedMap();
+        return true;
+    }
+
+    void RequestHandlerProcess::ReadInput(json::StreamedArray stat_requests) {
+        using namespace std::literals;
+
+        std::unordered_map<std::string, json::StreamedArray> streamed;
+        streamed.emplace("base_requests"s, json::StreamedArray{
+            [this](json::Node&& node, const json::Dict&) {
+                detail_base::RequestBaseProcess(builder_, node);
+            },
+            [this](const std::vector<std::string_view>& items, const json::Dict&) {
+                return detail_base::RequestBaseTextsProcess(builder_, items);
+            } });
+        if (stat_requests.on_item) {
+            streamed.emplace("stat_requests"s, std::move(stat_requests));
         }
+
+        reader_.emplace(input_, streamed);
     }
 
-    void RequestHandlerProcess::ExecuteStatProcess() {
-        json::Builder builder;
+    void RequestHandlerProcess::LoadBase(std::string_view file) {
+        const std::string path(file);
 
+        // Формат базы определяется по её сигнатуре, а не по настройкам
+        if (flat_serialization::IsFlatBase(path)) {
+            flat_serialization::Deserialize(handler_, path);
+        }
+        else {
+            transport_serialization::Deserialize(handler_, path);
+        }
+    }
+
+    bool RequestHandlerProcess::ReuseRouter(std::string_view file) {
+        const std::string path(file);
+
+        if (flat_serialization::IsFlatBase(path)) {
+            return flat_serialization::ReuseRouter(handler_, path);
+        }
+        return transport_serialization::ReuseRouter(handler_, path);
+    }
+
+    void RequestHandlerProcess::ExecuteBaseProcess() {
         {
-            // Получаем результат
-            builder.StartArray();
-            for (const json::Node* node : reader_.StatRequests()) {
-                detail_stat::RequestStatProcess(builder, handler_, node);
-            }
-            builder.EndArray();
+            // Остановки, расстояния и маршруты уже переданы в builder_ при потоковом разборе base_requests
+            builder_.Commit(catalogue_);
+        }
+
+        {
+            // Создаём переменную с настройками маршрута
+            catalogue_.SetBusRouteCommonSettings(detail_base::CreateRouteSettings(reader_->RoutingSettings()));
         }
 
         {
-            // Выводим результат
-            json::Print(json::Document(builder.Build()), output_);
+            // Инициализируем карту маршрутов
+            if (!reader_->RenderSettings().empty()) {
+                detail_base::RequestBaseMapProcess(handler_, reader_->RenderSettings());
+            }
         }
     }
 
+    void RequestHandlerProcess::ExecuteStatProcess() {
+        json::Writer writer(output_, options_.compact_output);
+        writer.StartArray();
+        detail_stat::RequestStatListProcess(writer, handler_, reader_->StatRequests());
+        writer.EndArray();
+    }
+
 } // namespace request_handler
@@ -1,17 +1,22 @@
 #pragma once
 
+#include <functional>
 #include <istream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <ostream>
 #include <set>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <variant>
+#include <vector>
 
 #include "json.h"
 #include "json_builder.h"
 #include "json_reader.h"
+#include "json_writer.h"
 #include "geo.h"
 #include "map_renderer.h"
 #include "transport_catalogue.h"
@@ -22,12 +27,33 @@ namespace request_handler {
     enum class ProgrammType {
         MAKE_BASE,
         PROCESS_REQUESTS,
+        SERVE,
         OLD_TESTS,
         UNKNOWN
     };
 
     ProgrammType ParseProgrammType(int argc, const char** argv);
 
+    // Параметры запуска, переданные в командной строке после режима работы
+    struct ProgrammOptions {
+        // Ответы выводятся в компактном JSON без пробелов и переводов строк (--compact)
+        bool compact_output = false;
+
+        // Запросы читаются построчно в формате JSON Lines, ответ на каждый выводится отдельной строкой (--jsonl)
+        bool json_lines = false;
+
+        // Путь Unix-сокета, на котором режим serve принимает запросы (--socket <path>).
+        // Если не задан, serve читает запросы из стандартного ввода, как process_requests --jsonl
+        std::string socket_path;
+
+        // Прежняя база, из которой make_base берёт граф и роутер, если они построены по тем же данным
+        // (--previous-base <path>). Если не задана, используется заменяемый файл базы
+        std::string previous_base;
+    };
+
+    // Функция возвращает std::nullopt, если встретился неизвестный параметр
+    std::optional<ProgrammOptions> ParseProgrammOptions(int argc, const char** argv);
+
     // ---------- RequestHandler --------------------------------------------------
 
     class RequestHandler {
@@ -35,6 +61,15 @@ namespace request_handler {
         using RouteData = transport_graph::TransportRouter::TransportRouterData;
 
     public:
+        // Загрузчики графа и матрицы маршрутов роутера из базы, вызываются при первом запросе маршрута.
+        // Матрица не зависит от графа, поэтому загрузчики выполняются параллельно
+        using GraphLoader = std::function<transport_graph::TransportGraph()>;
+        using RoutesLoader = std::function<graph::Router<transport_graph::TransportTime>::RoutesInternalData()>;
+
+        // Загрузчик сохранённой в базе экранированной карты. Возвращает std::nullopt,
+        // если сохранённая карта не соответствует каталогу или настройкам
+        using MapLoader = std::function<std::optional<std::string>()>;
+
         RequestHandler(transport_catalogue::TransportCatalogue& catalogue);
 
         // Метод добавляет новую остановку
@@ -42,26 +77,28 @@ namespace request_handler {
 
         void AddStop(size_t id, std::string&& name, Coordinates&& coord);
 
-        void AddStop(size_t id, transport_catalogue::stop_catalogue::Stop&& stop) {
-            catalogue_.AddStop(id, std::move(stop));
-        }
-
         // Метод добавляет реальную дистанцию между двумя остановками
         void AddDistance(std::string_view name_from, std::string_view name_to, double distance);
 
         // Метод добавляет новый маршрут
         void AddBus(transport_catalogue::bus_catalogue::BusHelper&& bus_helper);
 
-        void AddBus(transport_catalogue::bus_catalogue::Bus&& bus) {
+        void AddBus(transport_catalogue::bus_catalogue::BusData&& bus) {
             catalogue_.AddBus(std::move(bus));
         }
 
-        void AddBus(size_t id, transport_catalogue::bus_catalogue::Bus&& bus) {
+        void AddBus(size_t id, transport_catalogue::bus_catalogue::BusData&& bus) {
             catalogue_.AddBus(id, std::move(bus));
         }
 
-        // Метод инициализирует переменную с значением карты маршрутов в svg формате
-        void RenderMap(map_renderer::MapRendererSettings&& settings);
+        // Метод задаёт настройки карты маршрутов. Сама карта отрисовывается при первом обращении к GetEscapedMap
+        void SetMapRenderSettings(map_renderer::MapRendererSettings&& settings);
+
+        // Метод задаёт загрузку готовой карты из базы при первом обращении к GetEscapedMap.
+        // Если загрузчик вернул std::nullopt, карта отрисовывается по настройкам
+        void SetMapLoader(MapLoader map_loader) {
+            map_loader_ = std::move(map_loader);
+        }
 
         // Метод проверяет правильность маршрута
         bool IsRouteValid(
@@ -96,6 +133,20 @@ namespace request_handler {
             router_ = std::make_unique<transport_graph::TransportRouter>(std::move(router));
         }
 
+        // Метод устанавливает граф вместе с построенным по нему роутером.
+        // Роутер ссылается на граф, поэтому граф передаётся уже размещённым в динамической памяти
+        void SetRouter(std::unique_ptr<transport_graph::TransportGraph>&& graph, transport_graph::TransportRouter&& router) {
+            graph_ = std::move(graph);
+            router_ = std::make_unique<transport_graph::TransportRouter>(std::move(router));
+        }
+
+        // Метод откладывает загрузку графа и роутера до первого запроса маршрута.
+        // Если routes_loader не задан, роутер строится по загруженному графу
+        void SetRouterLoaders(GraphLoader graph_loader, RoutesLoader routes_loader) {
+            graph_loader_ = std::move(graph_loader);
+            routes_loader_ = std::move(routes_loader);
+        }
+
         // Метод возвращает массив автобусов, проходящих через заданную остановку
         const std::set<std::string_view>& GetStopBuses(std::string_view name) const {
             return catalogue_.GetBusesForStop(name);
@@ -106,10 +157,9 @@ namespace request_handler {
             return catalogue_.GetBuses().At(name);
         }
 
-        // Метод возвращает инициализированную ранее переменную с картой маршрутов в svg формате
-        const std::optional<std::string>& GetMap() const {
-            return map_renderer_value_;
-        }
+        // Метод возвращает карту маршрутов в svg формате, экранированную как JSON строка.
+        // Карта отрисовывается при первом обращении. Потокобезопасен
+        const std::optional<std::string>& GetEscapedMap() const;
 
         // Метод возвращает настройки отображения карты маршрутов
         const std::optional<map_renderer::MapRendererSettings>& GetMapRenderSettings() const {
@@ -119,7 +169,7 @@ namespace request_handler {
         // Метод возвращает данные маршрута от остановки from до остановки to
         std::optional<RouteData> GetRoute(std::string_view from, std::string_view to) const;
 
-        // Метод инициализирует маршрутиризатор
+        // Метод инициализирует маршрутиризатор, загружая граф и роутер из базы или строя их по каталогу. Потокобезопасен
         void InitRouter() const;
 
         // Метод возвращает все существующие остановки
@@ -128,6 +178,11 @@ namespace request_handler {
         // Метод возвращает все существующие автобусные маршруты
         std::vector<const transport_catalogue::bus_catalogue::Bus*> GetBuses() const;
 
+        // Метод возвращает отпечаток данных, от которых зависят граф и роутер: номеров остановок,
+        // маршрутов автобусов, расстояний между соседними остановками маршрутов и настроек маршрута.
+        // Названия и координаты остановок в отпечаток не входят
+        uint64_t GetRoutingFingerprint() const;
+
         // Метод возвращает настройки маршрута
         const transport_catalogue::RouteSettings& GetRouteSettings() const {
             return catalogue_.GetBuses().GetRouteSettings();
@@ -163,10 +218,15 @@ namespace request_handler {
 
     private:
         transport_catalogue::TransportCatalogue& catalogue_;
-        std::optional<std::string> map_renderer_value_;
         std::optional<map_renderer::MapRendererSettings> map_render_settings_;
+        mutable std::optional<std::string> escaped_map_value_;
+        mutable MapLoader map_loader_;
+        mutable std::once_flag map_render_flag_;
         mutable std::unique_ptr<transport_graph::TransportGraph> graph_;
         mutable std::unique_ptr<transport_graph::TransportRouter> router_;
+        mutable GraphLoader graph_loader_;
+        mutable RoutesLoader routes_loader_;
+        mutable std::once_flag router_init_flag_;
     };
 
 
@@ -175,11 +235,51 @@ namespace request_handler {
 
         // Функция обрабатывает запрос на создание остановки
         void RequestBaseStopProcess(
-            RequestHandler& request_handler,
+            transport_catalogue::TransportCatalogueBuilder& builder,
             const json::Node* node);
 
         // Функция обрабатывает запрос на создание автобусного маршрута
-        transport_catalogue::bus_catalogue::BusHelper RequestBaseBusProcess(const json::Node* node);
+        void RequestBaseBusProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            const json::Node* node);
+
+        // Функция обрабатывает очередной запрос из base_requests по мере его разбора
+        void RequestBaseProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            const json::Node& node);
+
+        // Запрос на создание остановки, разобранный без построения json::Node.
+        // Строки ссылаются на входной буфер
+        struct StopRequest {
+            std::string_view name;
+            Coordinates coordinates;
+            std::vector<std::pair<std::string_view, double>> road_distances;
+        };
+
+        // Запрос на создание автобусного маршрута, разобранный без построения json::Node
+        struct BusRequest {
+            std::string_view name;
+            bool is_roundtrip = false;
+            std::vector<std::string_view> stops;
+        };
+
+        // Запрос из base_requests. Запросы другой структуры хранятся в виде json::Node
+        using BaseRequest = std::variant<StopRequest, BusRequest, json::Node>;
+
+        // Функция разбирает исходный текст запроса из base_requests.
+        // Возвращает std::nullopt, если текст не является ровно одним JSON значением
+        std::optional<BaseRequest> DecodeBaseRequest(std::string_view item);
+
+        // Функция передаёт разобранный запрос в builder
+        void RequestBaseDecodedProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            BaseRequest&& request);
+
+        // Функция обрабатывает исходные тексты запросов base_requests по порядку
+        // и возвращает количество обработанных с начала запросов
+        size_t RequestBaseTextsProcess(
+            transport_catalogue::TransportCatalogueBuilder& builder,
+            const std::vector<std::string_view>& items);
 
         // Функция преобразует json узел в цвет
         svg::Color ParseColor(const json::Node* node);
@@ -201,36 +301,58 @@ namespace request_handler {
 
         // Функция обрабатывает запрос на получение информации об остановке
         void RequestStatStopProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request);
 
         // Функция обрабатывает запрос на получение информации о автобусе
         void RequestStatBusProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request);
 
         // Функция обрабатывает запрос на получение карты маршрутов
         void RequestMapProcess(
-            json::Builder& builder,
+            json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Dict& request);
 
         // Функция обрабатывающая все запросы
         void RequestStatProcess(
-            json::Builder& builder,
+            json::Writer& writer,
+            const RequestHandler& request_handler,
+            const json::Node* node);
+
+        // Функция выполняет запрос и возвращает ответ, отформатированный как очередной
+        // элемент массива writer. Не изменяет writer и может вызываться из разных потоков
+        std::string RequestStatItemProcess(
+            const json::Writer& writer,
             const RequestHandler& request_handler,
             const json::Node* node);
 
+        // Функция выполняет запросы и записывает ответы в writer в порядке запросов.
+        // Если запросов много, они выполняются в пуле потоков
+        void RequestStatListProcess(
+            json::Writer& writer,
+            const RequestHandler& request_handler,
+            const std::vector<const json::Node*>& nodes);
+
+        // Функция обрабатывает исходные тексты запросов stat_requests по порядку
+        // и возвращает количество обработанных с начала запросов. Если запросов мало,
+        // не обрабатывает ни одного: их выгоднее разобрать и выполнить обычным образом
+        size_t RequestStatTextsProcess(
+            json::Writer& writer,
+            const RequestHandler& request_handler,
+            const std::vector<std::string_view>& items);
+
     } // namespace detail_stat
 
     class RequestHandlerProcess {
     public:
-        RequestHandlerProcess(std::istream& input, std::ostream& output)
+        RequestHandlerProcess(std::istream& input, std::ostream& output, ProgrammOptions options = {})
             : input_(input)
             , output_(output)
-            , reader_(input)
+            , options_(options)
             , handler_(catalogue_) {
         }
 
@@ -240,14 +362,50 @@ namespace request_handler {
 
         void ExecuteProcessRequests();
 
+        // Первая строка ввода содержит serialization_settings, каждая следующая - один запрос
+        // из stat_requests. Запросы выполняются в пуле потоков до окончания ввода, ответы
+        // выводятся компактными строками в порядке запросов. Ошибка в запросе выводится
+        // как ответ с полем error_message и не прерывает обработку
+        void ExecuteProcessRequestLines();
+
+        // Режим serve: без socket_path работает как ExecuteProcessRequestLines. Иначе база
+        // загружается по serialization_settings из первой строки ввода, а запросы в том же
+        // построчном формате принимаются через Unix-сокет
+        void ExecuteServe();
+
     private:
+        // Разбирает входной документ; base_requests всегда передаются в builder_ потоково,
+        // а stat_requests - в stat_requests, если задан его on_item
+        void ReadInput(json::StreamedArray stat_requests = {});
+
         void ExecuteBaseProcess();
         void ExecuteStatProcess();
 
+        // Загружает базу из файла, указанного в настройках сериализации
+        void LoadBase(std::string_view file);
+
+        // Загружает граф и роутер из прежней базы file, если они построены по тем же данным.
+        // Возвращает false, если их нужно строить заново; граф и роутер тогда не изменяются
+        bool ReuseRouter(std::string_view file);
+
+        // Загружает базу по serialization_settings из первой непустой строки ввода вместе с графом,
+        // роутером и картой, не откладывая их до первого запроса. Возвращает false, если ввод пуст
+        bool LoadBaseFromSettingsLine();
+
+        // Выполняет запрос из строки line. Если строка не разбирается или запрос не выполняется,
+        // возвращает ответ с полем error_message и номером запроса, когда его удалось прочитать
+        std::string AnswerRequestLine(const json::Writer& format, std::string_view line) const;
+
+        static bool IsBlankLine(std::string_view line);
+
     private:
         std::istream& input_;
         std::ostream& output_;
-        const json::Reader reader_;
+        const ProgrammOptions options_;
+
+        // Запросы base_requests передаются в builder_ по мере разбора, не сохраняясь в документе
+        transport_catalogue::TransportCatalogueBuilder builder_;
+        std::optional<const json::Reader> reader_;
         RequestHandler handler_;
         transport_catalogue::TransportCatalogue catalogue_;
     };
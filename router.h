@@ -28,9 +28,30 @@ namespace graph {
     template <typename Weight>
     class RouterCreator {
     public:
+        // Данные маршрутов загружаются из файла базы отдельно от графа, поэтому сверяются с ним
+        // здесь: BuildRoute обращается к ячейкам и рёбрам по сохранённым номерам без проверок
         static Router<Weight> Build(
             const graph::DirectedWeightedGraph<Weight>& graph,
             typename Router<Weight>::RoutesInternalData&& routes_internal_data) {
+            const size_t vertex_count = graph.GetVertexCount();
+            if (routes_internal_data.size() != vertex_count) {
+                throw std::logic_error("Corrupted router data");
+            }
+            for (const auto& row : routes_internal_data) {
+                if (row.size() != vertex_count) {
+                    throw std::logic_error("Corrupted router data");
+                }
+                for (const auto& route_internal_data : row) {
+                    if (!route_internal_data || !route_internal_data->prev_edge) {
+                        continue;
+                    }
+                    // Предыдущее ребро должно существовать, а маршрут до его начала - быть известен
+                    if (*route_internal_data->prev_edge >= graph.GetEdgeCount()
+                        || !row[graph.GetEdge(*route_internal_data->prev_edge).from]) {
+                        throw std::logic_error("Corrupted router data");
+                    }
+                }
+            }
             return { graph, std::move(routes_internal_data) };
         }
     };
@@ -138,6 +159,10 @@ namespace graph {
             edge_id;
             edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
         {
+            // Простой маршрут не длиннее числа рёбер, более длинная цепочка - цикл в повреждённых данных
+            if (edges.size() == graph_.GetEdgeCount()) {
+                throw std::logic_error("Corrupted router data");
+            }
             edges.push_back(*edge_id);
         }
         std::reverse(edges.begin(), edges.end());
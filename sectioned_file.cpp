@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "sectioned_file.h"
+
+namespace sectioned_file {
+
+    namespace {
+
+        // Данные записываются в порядке байт машины, записавшей файл. Метка позволяет
+        // отличить файл с другим порядком байт от повреждённого
+        constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+        constexpr uint64_t SECTION_ALIGNMENT = 8;
+
+        struct FileHeader {
+            Signature signature;
+            uint32_t version;
+            uint32_t byte_order_mark;
+            uint32_t section_count;
+            uint32_t reserved;
+        };
+
+        struct SectionEntry {
+            uint32_t kind;
+            uint32_t reserved;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        static_assert(sizeof(FileHeader) == 24 && sizeof(SectionEntry) == 24);
+
+        uint64_t Align(uint64_t offset) {
+            return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+        }
+
+    } // namespace
+
+    bool HasSignature(const std::string& file, const Signature& signature) {
+        std::ifstream in(file, std::ifstream::in | std::ifstream::binary);
+        Signature read{};
+        return in.read(read.data(), read.size()) && read == signature;
+    }
+
+    uint64_t Fingerprint(std::string_view bytes, uint64_t seed) {
+        static constexpr uint64_t PRIME = 1099511628211ull;
+
+        uint64_t hash = seed;
+        for (char c : bytes) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= PRIME;
+        }
+        return hash;
+    }
+
+    // ---------- Writer ----------------------------------------------------------
+
+    Writer::Writer(std::ostream& out, const Signature& signature, uint32_t version, uint32_t max_sections)
+        : out_(out)
+        , signature_(signature)
+        , version_(version)
+        , max_sections_(max_sections)
+        , start_(out.tellp()) {
+        if (!out_) {
+            throw std::logic_error("Couldn't write base file");
+        }
+        if (start_ == std::ostream::pos_type(-1)) {
+            throw std::logic_error("Base file output must be seekable");
+        }
+        entries_.reserve(max_sections);
+        // Неиспользованные записи таблицы остаются нулевыми и не читаются: их отсекает число разделов
+        WriteZeros(Align(sizeof(FileHeader) + max_sections * sizeof(SectionEntry)));
+    }
+
+    void Writer::WriteSection(uint32_t kind, std::string_view bytes) {
+        BeginSection(kind).write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        EndSection();
+    }
+
+    std::ostream& Writer::BeginSection(uint32_t kind) {
+        EndSection();
+        if (entries_.size() == max_sections_) {
+            throw std::logic_error("Too many sections in base file");
+        }
+
+        const uint64_t position = Position();
+        WriteZeros(Align(position) - position);
+        entries_.push_back({ kind, Align(position), 0 });
+        is_section_open_ = true;
+        return out_;
+    }
+
+    void Writer::Finish() {
+        EndSection();
+
+        FileHeader header{};
+        header.signature = signature_;
+        header.version = version_;
+        header.byte_order_mark = BYTE_ORDER_MARK;
+        header.section_count = static_cast<uint32_t>(entries_.size());
+
+        std::vector<SectionEntry> entries;
+        entries.reserve(entries_.size());
+        for (const Entry& entry : entries_) {
+            SectionEntry section_entry{};
+            section_entry.kind = entry.kind;
+            section_entry.offset = entry.offset;
+            section_entry.size = entry.size;
+            entries.push_back(section_entry);
+        }
+
+        const auto end = out_.tellp();
+        out_.seekp(start_);
+        out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out_.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(SectionEntry)));
+        out_.seekp(end);
+        out_.flush();
+        if (!out_) {
+            throw std::logic_error("Couldn't write base file");
+        }
+    }
+
+    uint64_t Writer::Position() {
+        return static_cast<uint64_t>(out_.tellp() - start_);
+    }
+
+    void Writer::WriteZeros(uint64_t count) {
+        static constexpr std::array<char, SECTION_ALIGNMENT * 8> zeros{};
+        while (count > 0) {
+            const uint64_t size = std::min<uint64_t>(count, zeros.size());
+            out_.write(zeros.data(), static_cast<std::streamsize>(size));
+            count -= size;
+        }
+    }
+
+    void Writer::EndSection() {
+        if (is_section_open_) {
+            entries_.back().size = Position() - entries_.back().offset;
+            is_section_open_ = false;
+        }
+    }
+
+    // ---------- Reader ----------------------------------------------------------
+
+    Reader::Reader(const std::string& file, const Signature& signature, uint32_t version)
+        : file_(file) {
+        Map();
+
+        auto corrupted = [this](const std::string& what) {
+            return std::logic_error("Corrupted base file \"" + file_ + "\": " + what);
+        };
+
+        FileHeader header{};
+        if (size_ < sizeof(header)) {
+            throw corrupted("file is too short");
+        }
+        std::memcpy(&header, data_, sizeof(header));
+        if (header.signature != signature) {
+            throw corrupted("wrong signature");
+        }
+        if (header.byte_order_mark != BYTE_ORDER_MARK) {
+            throw std::logic_error("Base file \"" + file_ + "\" was written with a different byte order");
+        }
+        if (header.version != version) {
+            throw std::logic_error("Unsupported version " + std::to_string(header.version) + " of base file \"" + file_ + "\"");
+        }
+        if (header.section_count > (size_ - sizeof(header)) / sizeof(SectionEntry)) {
+            throw corrupted("section table is truncated");
+        }
+
+        for (uint32_t i = 0; i < header.section_count; ++i) {
+            SectionEntry entry{};
+            std::memcpy(&entry, data_ + sizeof(header) + i * sizeof(SectionEntry), sizeof(entry));
+            if (entry.offset > size_ || entry.size > size_ - entry.offset) {
+                throw corrupted("section is out of file bounds");
+            }
+            sections_.emplace(entry.kind, std::string_view(data_ + entry.offset, static_cast<size_t>(entry.size)));
+        }
+    }
+
+    Reader::~Reader() {
+#if defined(__unix__) || defined(__APPLE__)
+        if (is_mapped_) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+#endif
+    }
+
+    std::string_view Reader::Section(uint32_t kind) const {
+        auto it = sections_.find(kind);
+        return it != sections_.end() ? it->second : std::string_view{};
+    }
+
+    void Reader::Map() {
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = open(file_.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::logic_error("Couldn't open base file \"" + file_ + "\"");
+        }
+        struct stat info {};
+        if (fstat(fd, &info) < 0) {
+            close(fd);
+            throw std::logic_error("Couldn't open base file \"" + file_ + "\"");
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ > 0) {
+            void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw std::logic_error("Couldn't map base file \"" + file_ + "\"");
+            }
+            data_ = static_cast<const char*>(data);
+            is_mapped_ = true;
+        }
+        close(fd);
+#else
+        std::ifstream in(file_, std::ifstream::in | std::ifstream::binary);
+        if (!in) {
+            throw std::logic_error("Couldn't open base file \"" + file_ + "\"");
+        }
+        buffer_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+#endif
+    }
+
+} // namespace sectioned_file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+* Файл из разделов: заголовок (сигнатура формата, версия, метка порядка байт),
+* таблица разделов и сами разделы, выровненные по 8 байт.
+* Раздел - произвольные байты, различаемые целым номером вида. Таблица позволяет
+* читать разделы независимо друг от друга и не трогать ненужные
+*/
+namespace sectioned_file {
+
+    // Сигнатура формата в начале файла
+    using Signature = std::array<char, 8>;
+
+    // Функция проверяет, начинается ли файл с сигнатуры signature
+    bool HasSignature(const std::string& file, const Signature& signature);
+
+    // Функция вычисляет 64-битный отпечаток FNV-1a данных bytes, продолжая отпечаток seed.
+    // Отпечаток не зависит от платформы и позволяет проверить, что сохранённые
+    // производные данные построены именно по этим разделам
+    uint64_t Fingerprint(std::string_view bytes, uint64_t seed = 14695981039346656037ull);
+
+    /*
+    * Потоковая запись файла из разделов. Разделы пишутся в out по мере создания и
+    * в памяти не накапливаются. Место под заголовок и таблицу на max_sections разделов
+    * резервируется в начале файла и заполняется в Finish, поэтому out должен
+    * поддерживать перемещение позиции записи
+    */
+    class Writer {
+    public:
+        Writer(std::ostream& out, const Signature& signature, uint32_t version, uint32_t max_sections);
+
+        Writer(const Writer&) = delete;
+        Writer& operator= (const Writer&) = delete;
+
+        // Метод записывает раздел kind целиком
+        void WriteSection(uint32_t kind, std::string_view bytes);
+
+        // Метод начинает раздел kind и возвращает поток для записи его содержимого.
+        // Раздел заканчивается при начале следующего раздела или в Finish
+        std::ostream& BeginSection(uint32_t kind);
+
+        // Метод записывает заголовок и таблицу разделов. Бросает std::logic_error при ошибке записи
+        void Finish();
+
+    private:
+        struct Entry {
+            uint32_t kind;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        uint64_t Position();
+
+        void WriteZeros(uint64_t count);
+
+        void EndSection();
+
+    private:
+        std::ostream& out_;
+        Signature signature_;
+        uint32_t version_;
+        uint32_t max_sections_;
+        std::ostream::pos_type start_;
+        std::vector<Entry> entries_;
+        bool is_section_open_ = false;
+    };
+
+    /*
+    * Файл из разделов, отображённый в память только для чтения. Там, где отображение
+    * недоступно, файл считывается целиком. Разделы ссылаются на отображение
+    * и действительны, пока жив объект
+    */
+    class Reader {
+    public:
+        // Бросает std::logic_error, если файл не открывается, повреждён,
+        // записан в другом формате, другой версии или с другим порядком байт
+        Reader(const std::string& file, const Signature& signature, uint32_t version);
+
+        Reader(const Reader&) = delete;
+        Reader& operator= (const Reader&) = delete;
+
+        ~Reader();
+
+        bool Has(uint32_t kind) const {
+            return sections_.count(kind) > 0;
+        }
+
+        // Отсутствующий раздел считается пустым
+        std::string_view Section(uint32_t kind) const;
+
+        const std::string& File() const {
+            return file_;
+        }
+
+    private:
+        void Map();
+
+    private:
+        std::string file_;
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool is_mapped_ = false;
+        std::string buffer_;
+        std::unordered_map<uint32_t, std::string_view> sections_;
+    };
+
+} // namespace sectioned_file
@@ -1,9 +1,22 @@
+#include <algorithm>
+#include <bitset>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include <google/protobuf/arena.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/wire_format_lite.h>
+
 #include "map_renderer.h"
 #include "svg.h"
+#include "sectioned_file.h"
 #include "serialization.h"
+#include "thread_pool.h"
 
 namespace transport_serialization {
 
@@ -20,8 +33,8 @@ namespace transport_serialization {
             transport_proto::Stop proto_stop;
 
             proto_stop.set_id(rh.GetId(stop));
-            proto_stop.set_name(stop->name);
-            *proto_stop.mutable_coord() = CreateProtoCoord(stop->coord);
+            proto_stop.set_name(std::string(stop->GetName()));
+            *proto_stop.mutable_coord() = CreateProtoCoord(stop->GetCoordinates());
 
             return proto_stop;
         }
@@ -30,15 +43,15 @@ namespace transport_serialization {
             transport_proto::Bus proto_bus;
 
             proto_bus.set_id(rh.GetId(bus));
-            proto_bus.set_name(bus->name);
-            for (const auto* stop : bus->route) {
+            proto_bus.set_name(std::string(bus->GetName()));
+            for (const auto* stop : bus->GetRoute()) {
                 proto_bus.add_route(rh.GetId(stop));
             }
-            proto_bus.set_type(static_cast<uint32_t>(bus->route_type));
-            proto_bus.set_route_geo_length(bus->route_geo_length);
-            proto_bus.set_route_true_length(bus->route_true_length);
-            proto_bus.set_stops_on_route(bus->stops_on_route);
-            proto_bus.set_unique_stops(bus->unique_stops);
+            proto_bus.set_type(static_cast<uint32_t>(bus->GetRouteType()));
+            proto_bus.set_route_geo_length(bus->GetRouteGeoLength());
+            proto_bus.set_route_true_length(bus->GetRouteTrueLength());
+            proto_bus.set_stops_on_route(bus->GetStopsOnRoute());
+            proto_bus.set_unique_stops(bus->GetUniqueStops());
 
             return proto_bus;
         }
@@ -91,115 +104,149 @@ namespace transport_serialization {
             return proto_settings;
         }
 
-        transport_proto::Edge CreateProtoEdge(const graph::Edge<double>& edge) {
-            transport_proto::Edge proto_edge;
-
-            proto_edge.set_from(edge.from);
-            proto_edge.set_to(edge.to);
-            proto_edge.set_weight(edge.weight);
-
-            return proto_edge;
-        }
-
-        transport_proto::IncidenceList CreateProtoIncidenceList(const graph::DirectedWeightedGraph<transport_graph::TransportTime>::IncidenceList& incidence_list) {
-            transport_proto::IncidenceList proto_incidence_list;
-
-            for (const auto& edge_id : incidence_list) {
-                proto_incidence_list.add_id(edge_id);
-            }
-
-            return proto_incidence_list;
-        }
-
-        transport_proto::TransportGraphData CreateProtoTransportGraphData(const transport_graph::TransportGraphData& data, const request_handler::RequestHandler& rh) {
-            transport_proto::TransportGraphData proto_data;
-
-            proto_data.set_stop_to_id(rh.GetId(data.to));
-            proto_data.set_stop_from_id(rh.GetId(data.from));
-            if (data.bus) {
-                proto_data.set_bus_id(rh.GetId(data.bus));
-                proto_data.set_is_bus(true);
-            }
-            else {
-                proto_data.set_is_bus(false);
-            }
-            proto_data.set_stop_count(data.stop_count);
-            proto_data.set_time(data.time);
-
-            return proto_data;
-        }
-
-        transport_proto::VertexIdLoop CreateProtoVertexIdLoop(const transport_graph::VertexIdLoop& vertex_id_loop) {
-            transport_proto::VertexIdLoop proto_vertex_id_loop;
-
-            proto_vertex_id_loop.set_id(vertex_id_loop.id);
-            proto_vertex_id_loop.set_transfer_id(vertex_id_loop.transfer_id);
-
-            return proto_vertex_id_loop;
-        }
-
+        // Граф записывается параллельными массивами в порядке номеров рёбер, остановки - по возрастанию номеров
         transport_proto::Graph CreateProtoGraph(const transport_graph::TransportGraph& graph, const request_handler::RequestHandler& rh) {
             transport_proto::Graph proto_graph;
+            transport_proto::PackedGraph& packed = *proto_graph.mutable_packed_graph();
 
             graph::GraphSerialization<transport_graph::TransportTime> gs;
-
-            for (const auto& edge : gs.GetEdges(graph.GetGraph())) {
-                *proto_graph.add_edge() = CreateProtoEdge(edge);
+            const auto& edges = gs.GetEdges(graph.GetGraph());
+            const auto& edge_id_to_graph_data = graph.GetEdgeIdToGraphData();
+
+            packed.mutable_from()->Reserve(static_cast<int>(edges.size()));
+            packed.mutable_to()->Reserve(static_cast<int>(edges.size()));
+            packed.mutable_weight()->Reserve(static_cast<int>(edges.size()));
+            packed.mutable_bus_id()->Reserve(static_cast<int>(edges.size()));
+            packed.mutable_stop_count()->Reserve(static_cast<int>(edges.size()));
+            for (size_t edge_id = 0; edge_id < edges.size(); ++edge_id) {
+                const auto& data = edge_id_to_graph_data.at(edge_id);
+                packed.add_from(static_cast<uint32_t>(edges[edge_id].from));
+                packed.add_to(static_cast<uint32_t>(edges[edge_id].to));
+                packed.add_weight(edges[edge_id].weight);
+                packed.add_bus_id(data.bus ? static_cast<uint32_t>(rh.GetId(data.bus)) + 1 : 0);
+                packed.add_stop_count(static_cast<uint32_t>(data.stop_count));
             }
 
+            uint32_t offset = 0;
+            packed.add_incidence_offset(offset);
             for (const auto& incidence_list : gs.GetIncidenceList(graph.GetGraph())) {
-                *proto_graph.add_incidence_list() = CreateProtoIncidenceList(incidence_list);
-            }
-
-            for (const auto& [edge_id, graph_data] : graph.GetEdgeIdToGraphData()) {
-                (*proto_graph.mutable_edge_id_to_graph_data())[static_cast<uint32_t>(edge_id)] = CreateProtoTransportGraphData(graph_data, rh);
+                for (graph::EdgeId edge_id : incidence_list) {
+                    packed.add_incidence_edge(static_cast<uint32_t>(edge_id));
+                }
+                offset += static_cast<uint32_t>(incidence_list.size());
+                packed.add_incidence_offset(offset);
             }
 
+            std::vector<std::pair<size_t, transport_graph::VertexIdLoop>> stop_vertices;
+            stop_vertices.reserve(graph.GetStopToVertexId().size());
             for (const auto& [stop_ptr, vertex_id_loop] : graph.GetStopToVertexId()) {
-                (*proto_graph.mutable_stop_to_vertex_id())[rh.GetId(stop_ptr)] = CreateProtoVertexIdLoop(vertex_id_loop);
+                stop_vertices.emplace_back(rh.GetId(stop_ptr), vertex_id_loop);
             }
-
-            return proto_graph;
-        }
-
-        transport_proto::RouteInternalData CreateProtoRouteInternalData(size_t pos, const graph::Router<transport_graph::TransportTime>::RouteInternalData& data) {
-            transport_proto::RouteInternalData proto_route_internal_data;
-
-            proto_route_internal_data.set_pos(pos);
-            proto_route_internal_data.set_weight(data.weight);
-            if (data.prev_edge) {
-                proto_route_internal_data.set_is_prev_edge(true);
-                proto_route_internal_data.set_prev_edge_id(*data.prev_edge);
-            }
-            else {
-                proto_route_internal_data.set_is_prev_edge(false);
+            std::sort(stop_vertices.begin(), stop_vertices.end(), [](const auto& lhs, const auto& rhs) {
+                return lhs.first < rhs.first;
+            });
+            for (const auto& [stop_id, vertex_id_loop] : stop_vertices) {
+                packed.add_stop_id(static_cast<uint32_t>(stop_id));
+                packed.add_stop_vertex(static_cast<uint32_t>(vertex_id_loop.id));
+                packed.add_stop_transfer_vertex(static_cast<uint32_t>(vertex_id_loop.transfer_id));
             }
 
-            return proto_route_internal_data;
+            return proto_graph;
         }
 
-        transport_proto::Router CreateProtoRouter(const transport_graph::TransportRouter& transport_router) {
-            transport_proto::Router proto_router;
+        // Функция записывает сообщение Router с упакованной матрицей маршрутов прямо в out, не собирая
+        // его в памяти. Размеры полей считаются первым проходом по матрице, значения пишутся вторым.
+        // Байты совпадают с SerializeToOstream для того же сообщения
+        void WriteProtoRouter(std::ostream& out, const transport_graph::TransportRouter& transport_router) {
+            using google::protobuf::io::CodedOutputStream;
+            using google::protobuf::internal::WireFormatLite;
 
             const auto& router = transport_graph::TransportRouterGetter::GetRouter(transport_router);
+            const auto& routes_internal_data = graph::RouterDataGetter<transport_graph::TransportTime>::GetInternalData(router);
+            const uint32_t vertex_count = static_cast<uint32_t>(routes_internal_data.size());
+
+            auto prev_edge_value = [](const auto& internal_data) {
+                return internal_data.prev_edge ? static_cast<uint32_t>(*internal_data.prev_edge) + 1 : 0u;
+            };
 
-            transport_proto::RoutesInternalData routes_internal_data;
-            for (const auto& vector_with_internal_data : graph::RouterDataGetter<transport_graph::TransportTime>::GetInternalData(router)) {
-                transport_proto::RouteInternalDataVector data_vector;
-                data_vector.set_size(vector_with_internal_data.size());
-                size_t pos = 0;
-                for (const auto& internal_data : vector_with_internal_data) {
+            size_t reachable_count = 0;
+            size_t prev_edge_size = 0;
+            for (const auto& row : routes_internal_data) {
+                for (const auto& internal_data : row) {
                     if (internal_data) {
-                        *data_vector.add_route_internal_data() = CreateProtoRouteInternalData(pos, *internal_data);
+                        ++reachable_count;
+                        prev_edge_size += CodedOutputStream::VarintSize32(prev_edge_value(*internal_data));
                     }
-                    pos++;
                 }
-                *routes_internal_data.add_routes_internal_data_vector() = std::move(data_vector);
+            }
+            const size_t reachable_size = (static_cast<size_t>(vertex_count) * vertex_count + 7) / 8;
+            const size_t weight_size = reachable_count * WireFormatLite::kDoubleSize;
+
+            // Поле длиной size: тег, длина и данные. Пустые поля proto3 не записываются
+            auto field_size = [](size_t size) {
+                return size > 0 ? 1 + CodedOutputStream::VarintSize64(size) + size : 0;
+            };
+            const size_t packed_size = (vertex_count > 0 ? 1 + CodedOutputStream::VarintSize32(vertex_count) : 0)
+                + field_size(reachable_size) + field_size(weight_size) + field_size(prev_edge_size);
+
+            google::protobuf::io::OstreamOutputStream stream(&out);
+            CodedOutputStream coded(&stream);
+
+            coded.WriteTag(WireFormatLite::MakeTag(transport_proto::Router::kPackedRoutesInternalDataFieldNumber,
+                WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+            coded.WriteVarint64(packed_size);
+
+            if (vertex_count > 0) {
+                coded.WriteTag(WireFormatLite::MakeTag(transport_proto::PackedRoutesInternalData::kVertexCountFieldNumber,
+                    WireFormatLite::WIRETYPE_VARINT));
+                coded.WriteVarint32(vertex_count);
             }
 
-            *proto_router.mutable_routes_internal_data() = std::move(routes_internal_data);
+            auto begin_field = [&coded](int field_number, size_t size) {
+                if (size == 0) {
+                    return false;
+                }
+                coded.WriteTag(WireFormatLite::MakeTag(field_number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED));
+                coded.WriteVarint64(size);
+                return true;
+            };
+
+            if (begin_field(transport_proto::PackedRoutesInternalData::kReachableFieldNumber, reachable_size)) {
+                uint8_t byte = 0;
+                size_t bit = 0;
+                for (const auto& row : routes_internal_data) {
+                    for (const auto& internal_data : row) {
+                        byte |= static_cast<uint8_t>(internal_data.has_value() << (bit % 8));
+                        if (++bit % 8 == 0) {
+                            coded.WriteRaw(&byte, 1);
+                            byte = 0;
+                        }
+                    }
+                }
+                if (bit % 8 != 0) {
+                    coded.WriteRaw(&byte, 1);
+                }
+            }
+
+            if (begin_field(transport_proto::PackedRoutesInternalData::kWeightFieldNumber, weight_size)) {
+                for (const auto& row : routes_internal_data) {
+                    for (const auto& internal_data : row) {
+                        if (internal_data) {
+                            coded.WriteLittleEndian64(WireFormatLite::EncodeDouble(internal_data->weight));
+                        }
+                    }
+                }
+            }
 
-            return proto_router;
+            if (begin_field(transport_proto::PackedRoutesInternalData::kPrevEdgeFieldNumber, prev_edge_size)) {
+                for (const auto& row : routes_internal_data) {
+                    for (const auto& internal_data : row) {
+                        if (internal_data) {
+                            coded.WriteVarint32(prev_edge_value(*internal_data));
+                        }
+                    }
+                }
+            }
         }
 
     } // namespace detail_serialization
@@ -215,17 +262,8 @@ namespace transport_serialization {
             return coord;
         }
 
-        transport_catalogue::stop_catalogue::Stop CreateStop(const transport_proto::Stop& proto_stop) {
-            transport_catalogue::stop_catalogue::Stop stop;
-
-            stop.name = proto_stop.name();
-            stop.coord = CreateCoord(proto_stop.coord());
-
-            return stop;
-        }
-
-        transport_catalogue::bus_catalogue::Bus CreateBus(const transport_proto::Bus& proto_bus, const request_handler::RequestHandler& rh) {
-            transport_catalogue::bus_catalogue::Bus bus;
+        transport_catalogue::bus_catalogue::BusData CreateBus(const transport_proto::Bus& proto_bus, const request_handler::RequestHandler& rh) {
+            transport_catalogue::bus_catalogue::BusData bus;
 
             bus.name = proto_bus.name();
             for (int i = 0; i < proto_bus.route_size(); ++i) {
@@ -318,7 +356,7 @@ namespace transport_serialization {
         }
 
         transport_graph::TransportGraphData CreateTransportGraphData(
-            const transport_proto::TransportGraphData& proto_data, request_handler::RequestHandler& rh) {
+            const transport_proto::TransportGraphData& proto_data, const request_handler::RequestHandler& rh) {
             transport_graph::TransportGraphData data{};
 
             data.from = rh.GetStopById(proto_data.stop_from_id());
@@ -344,9 +382,94 @@ namespace transport_serialization {
             return vertex_id_loop;
         }
 
-        transport_graph::TransportGraph CreateGraph(const transport_proto::Graph& proto_graph, request_handler::RequestHandler& rh) {
+        transport_graph::TransportGraph CreatePackedGraph(const transport_proto::PackedGraph& packed, const request_handler::RequestHandler& rh) {
             using namespace transport_graph;
 
+            auto corrupted = [] {
+                return std::logic_error("Corrupted packed graph data");
+            };
+
+            const size_t edge_count = packed.from_size();
+            if (packed.to_size() != packed.from_size() || packed.weight_size() != packed.from_size()
+                || packed.bus_id_size() != packed.from_size() || packed.stop_count_size() != packed.from_size()
+                || packed.incidence_offset_size() == 0 || packed.stop_vertex_size() != packed.stop_id_size()
+                || packed.stop_transfer_vertex_size() != packed.stop_id_size()) {
+                throw corrupted();
+            }
+            const size_t vertex_count = packed.incidence_offset_size() - 1;
+
+            // Остановка каждой вершины нужна для восстановления остановок рёбер
+            std::vector<const stop_catalogue::Stop*> vertex_stops(vertex_count, nullptr);
+            std::unordered_map<const stop_catalogue::Stop*, VertexIdLoop> stop_to_vertex_id;
+            stop_to_vertex_id.reserve(packed.stop_id_size());
+            for (int i = 0; i < packed.stop_id_size(); ++i) {
+                const auto* stop = rh.GetStopById(packed.stop_id(i));
+                const VertexIdLoop vertex_id_loop{ packed.stop_vertex(i), packed.stop_transfer_vertex(i) };
+                if (!stop || vertex_id_loop.id >= vertex_count || vertex_id_loop.transfer_id >= vertex_count) {
+                    throw corrupted();
+                }
+                vertex_stops[vertex_id_loop.id] = stop;
+                vertex_stops[vertex_id_loop.transfer_id] = stop;
+                stop_to_vertex_id.emplace(stop, vertex_id_loop);
+            }
+
+            std::vector<graph::Edge<TransportTime>> edges;
+            edges.reserve(edge_count);
+            std::unordered_map<graph::EdgeId, TransportGraphData> edge_id_to_graph_data;
+            edge_id_to_graph_data.reserve(edge_count);
+            for (size_t edge_id = 0; edge_id < edge_count; ++edge_id) {
+                const int i = static_cast<int>(edge_id);
+                const graph::Edge<TransportTime> edge{ packed.from(i), packed.to(i), packed.weight(i) };
+                if (edge.from >= vertex_count || edge.to >= vertex_count || !vertex_stops[edge.from] || !vertex_stops[edge.to]) {
+                    throw corrupted();
+                }
+
+                const bus_catalogue::Bus* bus = nullptr;
+                if (packed.bus_id(i) != 0) {
+                    bus = rh.GetBusById(packed.bus_id(i) - 1);
+                    if (!bus) {
+                        throw corrupted();
+                    }
+                }
+
+                edge_id_to_graph_data.emplace(edge_id, TransportGraphData{
+                    vertex_stops[edge.from], vertex_stops[edge.to], bus, static_cast<int>(packed.stop_count(i)), edge.weight });
+                edges.push_back(edge);
+            }
+
+            std::vector<graph::DirectedWeightedGraph<TransportTime>::IncidenceList> incidence_lists(vertex_count);
+            for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+                const uint32_t begin = packed.incidence_offset(static_cast<int>(vertex));
+                const uint32_t end = packed.incidence_offset(static_cast<int>(vertex) + 1);
+                if (begin > end || end > static_cast<uint32_t>(packed.incidence_edge_size())) {
+                    throw corrupted();
+                }
+                incidence_lists[vertex].reserve(end - begin);
+                for (uint32_t i = begin; i < end; ++i) {
+                    const uint32_t edge_id = packed.incidence_edge(static_cast<int>(i));
+                    if (edge_id >= edge_count) {
+                        throw corrupted();
+                    }
+                    incidence_lists[vertex].push_back(edge_id);
+                }
+            }
+
+            TransportGraphDeserialization deserializer;
+
+            deserializer.CreateGraph(std::move(edges), std::move(incidence_lists));
+            deserializer.SetEdgeIdToGraphData(std::move(edge_id_to_graph_data));
+            deserializer.SetStopToVertexId(std::move(stop_to_vertex_id));
+
+            return deserializer.Build();
+        }
+
+        transport_graph::TransportGraph CreateGraph(const transport_proto::Graph& proto_graph, const request_handler::RequestHandler& rh) {
+            using namespace transport_graph;
+
+            if (proto_graph.has_packed_graph()) {
+                return CreatePackedGraph(proto_graph.packed_graph(), rh);
+            }
+
             std::vector<graph::Edge<TransportTime>> edges;
             std::vector<graph::DirectedWeightedGraph<TransportTime>::IncidenceList> incidence_lists;
             std::unordered_map<graph::EdgeId, TransportGraphData> edge_id_to_graph_data;
@@ -388,16 +511,91 @@ namespace transport_serialization {
             return data;
         }
 
-        transport_graph::TransportRouter CreateRouter(const transport_graph::TransportGraph* ptr_graph, const transport_proto::Router& proto_router) {
+        // Пакет строк матрицы маршрутов, разбираемый одной задачей, и наименьшее число строк,
+        // при котором разбор распараллеливается
+        static constexpr size_t PARALLEL_MIN_ROWS = 256;
+        static constexpr size_t PARALLEL_BATCH_SIZE = 16;
+
+        RoutesInternalData DecodeRoutesInternalData(size_t row_count, const std::function<RoutesInternalDataRow(size_t row)>& decode_row) {
+            RoutesInternalData routes_internal_data;
+            routes_internal_data.reserve(row_count);
+
+            if (row_count < PARALLEL_MIN_ROWS || thread_pool::ThreadPool::DefaultThreadCount() == 1) {
+                for (size_t row = 0; row < row_count; ++row) {
+                    routes_internal_data.push_back(decode_row(row));
+                }
+                return routes_internal_data;
+            }
+
+            thread_pool::ForEachOrdered(row_count, PARALLEL_BATCH_SIZE, decode_row, [&routes_internal_data](RoutesInternalDataRow&& row) {
+                routes_internal_data.push_back(std::move(row));
+                return true;
+            });
+            return routes_internal_data;
+        }
+
+        // Функция считает установленные биты bits в диапазоне [begin, end)
+        size_t CountBits(const std::string& bits, size_t begin, size_t end) {
+            size_t count = 0;
+            for (; begin < end && begin % 8 != 0; ++begin) {
+                count += (bits[begin / 8] >> (begin % 8)) & 1;
+            }
+            for (; begin + 8 <= end; begin += 8) {
+                count += std::bitset<8>(static_cast<unsigned char>(bits[begin / 8])).count();
+            }
+            for (; begin < end; ++begin) {
+                count += (bits[begin / 8] >> (begin % 8)) & 1;
+            }
+            return count;
+        }
+
+        RoutesInternalData CreatePackedRoutesInternalData(const transport_proto::PackedRoutesInternalData& packed) {
             using namespace graph;
             using namespace transport_graph;
 
-            Router<TransportTime>::RoutesInternalData routes_internal_data;
+            const size_t vertex_count = packed.vertex_count();
+            const std::string& reachable = packed.reachable();
+            if (reachable.size() * 8 < vertex_count * vertex_count || packed.weight_size() != packed.prev_edge_size()) {
+                throw std::logic_error("Corrupted packed router data");
+            }
+
+            // Значения строки начинаются после значений всех предыдущих строк
+            std::vector<size_t> row_values(vertex_count + 1, 0);
+            for (size_t row = 0; row < vertex_count; ++row) {
+                row_values[row + 1] = row_values[row] + CountBits(reachable, row * vertex_count, (row + 1) * vertex_count);
+            }
+            if (row_values.back() > static_cast<size_t>(packed.weight_size())) {
+                throw std::logic_error("Corrupted packed router data");
+            }
+
+            return DecodeRoutesInternalData(vertex_count, [&packed, &reachable, &row_values, vertex_count](size_t row) {
+                RoutesInternalDataRow routes_internal_data_row(vertex_count);
+                int value = static_cast<int>(row_values[row]);
+                size_t bit = row * vertex_count;
+                for (auto& internal_data : routes_internal_data_row) {
+                    if (reachable[bit / 8] & (1 << (bit % 8))) {
+                        const uint32_t prev_edge = packed.prev_edge(value);
+                        internal_data = Router<TransportTime>::RouteInternalData{
+                            packed.weight(value),
+                            prev_edge != 0 ? std::optional<EdgeId>(prev_edge - 1) : std::nullopt };
+                        ++value;
+                    }
+                    ++bit;
+                }
+                return routes_internal_data_row;
+            });
+        }
+
+        RoutesInternalData CreateRoutesInternalData(const transport_proto::Router& proto_router) {
+            if (proto_router.has_packed_routes_internal_data()) {
+                return CreatePackedRoutesInternalData(proto_router.packed_routes_internal_data());
+            }
 
-            for (int i = 0; i < proto_router.routes_internal_data().routes_internal_data_vector_size(); ++i) {
-                const auto& proto_data_vector = proto_router.routes_internal_data().routes_internal_data_vector(i);
+            const auto& proto_routes = proto_router.routes_internal_data();
+            return DecodeRoutesInternalData(proto_routes.routes_internal_data_vector_size(), [&proto_routes](size_t row) {
+                const auto& proto_data_vector = proto_routes.routes_internal_data_vector(static_cast<int>(row));
 
-                std::vector<std::optional<Router<TransportTime>::RouteInternalData>> routes_internal_data_vector(proto_data_vector.size());
+                RoutesInternalDataRow routes_internal_data_vector(proto_data_vector.size());
 
                 for (int j = 0; j < proto_data_vector.route_internal_data_size(); ++j) {
                     const auto& proto_internal_data = proto_data_vector.route_internal_data(j);
@@ -405,20 +603,115 @@ namespace transport_serialization {
                     routes_internal_data_vector.at(proto_internal_data.pos()) = CreateRouteInternalData(proto_internal_data);
                 }
 
-                routes_internal_data.emplace_back(std::move(routes_internal_data_vector));
-            }
+                return routes_internal_data_vector;
+            });
+        }
 
+        transport_graph::TransportRouter CreateRouter(const transport_graph::TransportGraph* ptr_graph, const transport_proto::Router& proto_router) {
             return transport_graph::TransportRouterCreator::Build(
                 *ptr_graph,
                 graph::RouterCreator<transport_graph::TransportTime>::Build(
                     ptr_graph->GetGraph(),
-                    std::move(routes_internal_data)
+                    CreateRoutesInternalData(proto_router)
                 )
             );
         }
 
     } // namespace detail_deserialization
 
+    namespace {
+
+        constexpr sectioned_file::Signature SIGNATURE = { 'T', 'C', 'P', 'R', 'O', 'T', 'O', '\0' };
+        constexpr uint32_t VERSION = 1;
+
+        // Каждый раздел - отдельное сообщение protobuf
+        enum class SectionKind : uint32_t {
+            CATALOGUE = 1,  // TransportCatalogue без графа и роутера
+            GRAPH,          // Graph
+            ROUTER,         // Router
+            MAP,            // RenderedMap
+            ROUTING         // RoutingFingerprint
+        };
+        constexpr uint32_t SECTION_COUNT = 5;
+
+        // Карта зависит только от каталога и настроек из раздела CATALOGUE и от версии отрисовки
+        uint64_t MapFingerprint(std::string_view catalogue_bytes) {
+            return sectioned_file::Fingerprint(catalogue_bytes,
+                sectioned_file::Fingerprint(std::to_string(map_renderer::RENDER_VERSION)));
+        }
+
+        // Арена для разбора size байт. Блоки не меньше самих данных, поэтому вложенные сообщения,
+        // элементы map и повторяющиеся поля занимают несколько крупных блоков вместо отдельного
+        // выделения памяти на каждое и освобождаются разом вместе с ареной
+        google::protobuf::ArenaOptions ArenaOptionsFor(size_t size) {
+            google::protobuf::ArenaOptions options;
+            options.start_block_size = std::max(options.start_block_size, size);
+            options.max_block_size = std::max(options.max_block_size, size);
+            return options;
+        }
+
+        // Функция разбирает раздел kind на арене и возвращает результат build от разобранного сообщения.
+        // Сообщение нужно только для построения структур каталога и освобождается сразу после build
+        template <typename Message, typename Build>
+        auto BuildFromSection(const sectioned_file::Reader& reader, SectionKind kind, Build build) {
+            const std::string_view bytes = reader.Section(static_cast<uint32_t>(kind));
+            google::protobuf::Arena arena(ArenaOptionsFor(bytes.size()));
+            Message* message = google::protobuf::Arena::CreateMessage<Message>(&arena);
+            if (!message->ParseFromArray(bytes.data(), static_cast<int>(bytes.size()))) {
+                throw std::logic_error("Corrupted section " + std::to_string(static_cast<uint32_t>(kind)) + " of base file \"" + reader.File() + "\"");
+            }
+            return build(std::as_const(*message));
+        }
+
+        // Функция загружает остановки, автобусы и настройки
+        void DeserializeCatalogue(request_handler::RequestHandler& rh, const transport_proto::TransportCatalogue& tc) {
+            using namespace detail_deserialization;
+
+            for (int i = 0; i < tc.stop_size(); ++i) {
+                const transport_proto::Stop& stop = tc.stop(i);
+                rh.AddStop(stop.id(), std::string(stop.name()), CreateCoord(stop.coord()));
+            }
+
+            for (int i = 0; i < tc.bus_size(); ++i) {
+                const transport_proto::Bus& bus = tc.bus(i);
+                rh.AddBus(bus.id(), CreateBus(bus, rh));
+            }
+
+            rh.SetMapRenderSettings(CreateMapRenderSettings(tc.map_render_setting()));
+
+            rh.SetRouteSettings(CreateRouteSettings(tc.route_settings()));
+        }
+
+        // База прежнего формата - одно сообщение TransportCatalogue, разбираемое целиком
+        void DeserializeSingleMessage(request_handler::RequestHandler& rh, const std::string& file) {
+            using namespace detail_deserialization;
+
+            std::ifstream in(file, std::ifstream::in | std::ifstream::binary | std::ifstream::ate);
+            if (!in) {
+                throw std::logic_error("Couldn't open base file \"" + file + "\"");
+            }
+            const std::streamoff size = static_cast<std::streamoff>(in.tellg());
+            in.seekg(0);
+
+            google::protobuf::Arena arena(ArenaOptionsFor(static_cast<size_t>(size)));
+            transport_proto::TransportCatalogue& tc = *google::protobuf::Arena::CreateMessage<transport_proto::TransportCatalogue>(&arena);
+            if (!tc.ParseFromIstream(&in)) {
+                throw std::logic_error("Corrupted base file \"" + file + "\"");
+            }
+
+            DeserializeCatalogue(rh, tc);
+
+            if (tc.has_graph()) {
+                rh.SetGraph(CreateGraph(tc.graph(), rh));
+            }
+
+            if (tc.has_router()) {
+                rh.SetRouter(CreateRouter(rh.GetGraph(), tc.router()));
+            }
+        }
+
+    } // namespace
+
     void Serialize(std::ofstream& out, const request_handler::RequestHandler& rh) {
         using namespace detail_serialization;
 
@@ -439,43 +732,120 @@ namespace transport_serialization {
 
         *tc.mutable_route_settings() = CreateProtoRouteSetting(rh.GetRouteSettings());
 
+        // Граф и роутер записываются в отдельные разделы, чтобы без запросов Route их можно было не разбирать.
+        // Разделы пишутся в файл сразу, роутер - построчно, без промежуточного сообщения
+        sectioned_file::Writer writer(out, SIGNATURE, VERSION, SECTION_COUNT);
+
+        {
+            const std::string catalogue = tc.SerializeAsString();
+            writer.WriteSection(static_cast<uint32_t>(SectionKind::CATALOGUE), catalogue);
+
+            // Карта отрисовывается один раз при создании базы, а не при каждом запуске process_requests
+            if (map_render_settings && rh.GetEscapedMap()) {
+                transport_proto::RenderedMap rendered_map;
+                rendered_map.set_fingerprint(MapFingerprint(catalogue));
+                rendered_map.set_escaped_svg(*rh.GetEscapedMap());
+                rendered_map.SerializeToOstream(&writer.BeginSection(static_cast<uint32_t>(SectionKind::MAP)));
+            }
+        }
+
         if (rh.GetGraph()) {
-            *tc.mutable_graph() = CreateProtoGraph(*rh.GetGraph(), rh);
+            CreateProtoGraph(*rh.GetGraph(), rh).SerializeToOstream(&writer.BeginSection(static_cast<uint32_t>(SectionKind::GRAPH)));
         }
 
         if (rh.GetRouter()) {
-            *tc.mutable_router() = CreateProtoRouter(*rh.GetRouter());
+            WriteProtoRouter(writer.BeginSection(static_cast<uint32_t>(SectionKind::ROUTER)), *rh.GetRouter());
+
+            // По отпечатку следующий make_base решает, можно ли взять граф и роутер из этой базы
+            transport_proto::RoutingFingerprint routing_fingerprint;
+            routing_fingerprint.set_fingerprint(rh.GetRoutingFingerprint());
+            writer.WriteSection(static_cast<uint32_t>(SectionKind::ROUTING), routing_fingerprint.SerializeAsString());
         }
 
-        tc.SerializeToOstream(&out);
+        writer.Finish();
     }
 
-    void Deserialize(request_handler::RequestHandler& rh, std::ifstream& in) {
+    void Deserialize(request_handler::RequestHandler& rh, const std::string& file) {
         using namespace detail_deserialization;
 
-        transport_proto::TransportCatalogue tc;
-        tc.ParseFromIstream(&in);
-
-        for (int i = 0; i < tc.stop_size(); ++i) {
-            const transport_proto::Stop& stop = tc.stop(i);
-            rh.AddStop(stop.id(), CreateStop(stop));
+        if (!sectioned_file::HasSignature(file, SIGNATURE)) {
+            DeserializeSingleMessage(rh, file);
+            return;
         }
 
-        for (int i = 0; i < tc.bus_size(); ++i) {
-            const transport_proto::Bus& bus = tc.bus(i);
-            rh.AddBus(bus.id(), CreateBus(bus, rh));
-        }
+        // Читатель разделяется с отложенными загрузчиками графа и роутера и держит файл отображённым до их вызова
+        auto reader = std::make_shared<const sectioned_file::Reader>(file, SIGNATURE, VERSION);
 
-        rh.RenderMap(CreateMapRenderSettings(tc.map_render_setting()));
+        BuildFromSection<transport_proto::TransportCatalogue>(*reader, SectionKind::CATALOGUE, [&rh](const auto& tc) {
+            DeserializeCatalogue(rh, tc);
+        });
 
-        rh.SetRouteSettings(CreateRouteSettings(tc.route_settings()));
+        if (reader->Has(static_cast<uint32_t>(SectionKind::MAP))) {
+            rh.SetMapLoader([reader] {
+                return BuildFromSection<transport_proto::RenderedMap>(*reader, SectionKind::MAP, [&reader](const auto& rendered_map) {
+                    if (rendered_map.fingerprint() != MapFingerprint(reader->Section(static_cast<uint32_t>(SectionKind::CATALOGUE)))) {
+                        return std::optional<std::string>{};
+                    }
+                    return std::optional<std::string>(rendered_map.escaped_svg());
+                });
+            });
+        }
+
+        if (!reader->Has(static_cast<uint32_t>(SectionKind::GRAPH))) {
+            return;
+        }
+
+        request_handler::RequestHandler::RoutesLoader routes_loader;
+        if (reader->Has(static_cast<uint32_t>(SectionKind::ROUTER))) {
+            routes_loader = [reader] {
+                return BuildFromSection<transport_proto::Router>(*reader, SectionKind::ROUTER, [](const auto& router) {
+                    return CreateRoutesInternalData(router);
+                });
+            };
+        }
+        rh.SetRouterLoaders(
+            [reader, &rh] {
+                return BuildFromSection<transport_proto::Graph>(*reader, SectionKind::GRAPH, [&rh](const auto& graph) {
+                    return CreateGraph(graph, rh);
+                });
+            },
+            std::move(routes_loader));
+    }
 
-        if (tc.has_graph()) {
-            rh.SetGraph(CreateGraph(tc.graph(), rh));
+    bool ReuseRouter(request_handler::RequestHandler& rh, const std::string& file) {
+        using namespace detail_deserialization;
+
+        if (!sectioned_file::HasSignature(file, SIGNATURE)) {
+            return false;
         }
 
-        if (tc.has_router()) {
-            rh.SetRouter(CreateRouter(rh.GetGraph(), tc.router()));
+        // Прежняя база лишь ускоряет построение, поэтому любая её ошибка означает полное построение
+        try {
+            const sectioned_file::Reader reader(file, SIGNATURE, VERSION);
+            if (!reader.Has(static_cast<uint32_t>(SectionKind::GRAPH)) || !reader.Has(static_cast<uint32_t>(SectionKind::ROUTER))
+                || !reader.Has(static_cast<uint32_t>(SectionKind::ROUTING))
+                || BuildFromSection<transport_proto::RoutingFingerprint>(reader, SectionKind::ROUTING, [](const auto& routing) {
+                    return routing.fingerprint();
+                }) != rh.GetRoutingFingerprint()) {
+                return false;
+            }
+
+            auto graph = std::make_unique<transport_graph::TransportGraph>(BuildFromSection<transport_proto::Graph>(reader, SectionKind::GRAPH, [&rh](const auto& proto_graph) {
+                return CreateGraph(proto_graph, rh);
+            }));
+            RoutesInternalData routes_internal_data = BuildFromSection<transport_proto::Router>(reader, SectionKind::ROUTER, [](const auto& router) {
+                return CreateRoutesInternalData(router);
+            });
+            auto router = transport_graph::TransportRouterCreator::Build(
+                *graph,
+                graph::RouterCreator<transport_graph::TransportTime>::Build(graph->GetGraph(), std::move(routes_internal_data)));
+
+            // Граф и роутер передаются вместе только после того, как оба собраны без ошибок
+            rh.SetRouter(std::move(graph), std::move(router));
+            return true;
+        }
+        catch (const std::logic_error&) {
+            return false;
         }
     }
 
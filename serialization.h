@@ -1,13 +1,47 @@
 #include <transport_catalogue.pb.h>
 
 #include <fstream>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
 
 #include "request_handler.h"
 
 namespace transport_serialization {
 
+	namespace detail_serialization {
+
+		transport_proto::MapRenderSettings CreateProtoMapRenderSettings(const map_renderer::MapRendererSettings& setting);
+
+		transport_proto::RouteSettings CreateProtoRouteSetting(const transport_catalogue::RouteSettings& settings);
+
+	} // namespace detail_serialization
+
+	namespace detail_deserialization {
+
+		map_renderer::MapRendererSettings CreateMapRenderSettings(const transport_proto::MapRenderSettings& proto_settings);
+
+		transport_catalogue::RouteSettings CreateRouteSettings(const transport_proto::RouteSettings& proto_settings);
+
+		using RoutesInternalData = graph::Router<transport_graph::TransportTime>::RoutesInternalData;
+		using RoutesInternalDataRow = std::vector<std::optional<graph::Router<transport_graph::TransportTime>::RouteInternalData>>;
+
+		// Функция собирает матрицу маршрутов из row_count строк, полученных от decode_row.
+		// Строки независимы, поэтому при большом их числе разбираются параллельно пакетами
+		RoutesInternalData DecodeRoutesInternalData(size_t row_count, const std::function<RoutesInternalDataRow(size_t row)>& decode_row);
+
+	} // namespace detail_deserialization
+
 	void Serialize(std::ofstream& out, const request_handler::RequestHandler& request_handler);
 
-	void Deserialize(request_handler::RequestHandler& request_handler, std::ifstream& in);
+	// Граф и роутер загружаются при первом запросе маршрута.
+	// Базы прежнего формата из одного сообщения загружаются целиком
+	void Deserialize(request_handler::RequestHandler& request_handler, const std::string& file);
+
+	// Функция загружает граф и роутер из базы file, если они построены по тем же данным, что и
+	// каталог request_handler (см. RequestHandler::GetRoutingFingerprint). Возвращает false,
+	// если базы нет, она в другом формате, повреждена или построена по другим данным
+	bool ReuseRouter(request_handler::RequestHandler& request_handler, const std::string& file);
 
 } // namespace transport_serialization
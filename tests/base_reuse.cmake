@@ -0,0 +1,69 @@
+# Проверяет, что база, собранная make_base с переиспользованием графа и маршрутизатора
+# предыдущей базы, побайтно совпадает с базой, собранной с нуля по тем же запросам.
+# Предыдущая база берётся из заменяемого файла или из файла, заданного --previous-base.
+#
+# Параметры: TRANSPORT_CATALOGUE - путь к программе, WORK_DIR - каталог для временных файлов
+
+set(TEMPLATE ${CMAKE_CURRENT_LIST_DIR}/base_reuse/make_base.json.in)
+
+# Необязательный пятый аргумент - путь предыдущей базы для --previous-base
+function(make_base base_file format stop latitude)
+    set(BASE_FILE ${base_file})
+    set(BASE_FORMAT ${format})
+    set(CHANGED_STOP ${stop})
+    set(CHANGED_LATITUDE ${latitude})
+    configure_file(${TEMPLATE} ${WORK_DIR}/make_base.json @ONLY)
+
+    set(options)
+    if(ARGC GREATER 4)
+        set(options --previous-base ${ARGV4})
+    endif()
+
+    execute_process(
+        COMMAND ${TRANSPORT_CATALOGUE} make_base ${options}
+        INPUT_FILE ${WORK_DIR}/make_base.json
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "make_base failed for ${base_file}")
+    endif()
+endfunction()
+
+function(expect_same_as_fresh base_file fresh_file what)
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files ${base_file} ${fresh_file}
+        RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${what} differs from a fresh one")
+    endif()
+endfunction()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# moved - меняются только координаты, и маршрутизатор переиспользуется;
+# renamed - меняется имя остановки, а с ним порядок вершин графа.
+# Новая база пишется сначала в отдельный файл по --previous-base, затем поверх предыдущей
+foreach(format protobuf flat)
+    foreach(change moved renamed)
+        set(previous ${WORK_DIR}/${format}_${change}_previous.db)
+        set(reused ${WORK_DIR}/${format}_${change}_reused.db)
+        set(fresh ${WORK_DIR}/${format}_${change}_fresh.db)
+        file(REMOVE ${previous} ${reused} ${fresh})
+
+        if(change STREQUAL moved)
+            set(stop Arbatskaya)
+            set(latitude 55.70)
+        else()
+            set(stop Zarechnaya)
+            set(latitude 55.60)
+        endif()
+
+        make_base(${fresh} ${format} ${stop} ${latitude})
+        make_base(${previous} ${format} Arbatskaya 55.60)
+
+        make_base(${reused} ${format} ${stop} ${latitude} ${previous})
+        expect_same_as_fresh(${reused} ${fresh} "${format} base built with --previous-base after a ${change} stop")
+
+        make_base(${previous} ${format} ${stop} ${latitude})
+        expect_same_as_fresh(${previous} ${fresh} "${format} base built over the previous one after a ${change} stop")
+    endforeach()
+endforeach()
@@ -0,0 +1,64 @@
+#include <utility>
+
+#include "thread_pool.h"
+
+namespace thread_pool {
+
+    ThreadPool::ThreadPool(size_t thread_count) {
+        workers_.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers_.emplace_back([this] {
+                Work();
+            });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock(mutex_);
+            is_stopped_ = true;
+        }
+        condition_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::DefaultThreadCount() {
+        const size_t count = std::thread::hardware_concurrency();
+        return count > 0 ? count : 1;
+    }
+
+    ThreadPool& ThreadPool::Shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    void ThreadPool::Push(std::function<void()>&& task) {
+        {
+            std::lock_guard lock(mutex_);
+            tasks_.push(std::move(task));
+        }
+        condition_.notify_one();
+    }
+
+    void ThreadPool::Work() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                condition_.wait(lock, [this] {
+                    return is_stopped_ || !tasks_.empty();
+                });
+                // Очередь дорабатывается до конца даже после остановки
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop();
+            }
+            task();
+        }
+    }
+
+} // namespace thread_pool
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace thread_pool {
+
+    /*
+    * Пул потоков с общей очередью задач.
+    * Результат и исключение задачи передаются через std::future.
+    * Деструктор дожидается выполнения всех поставленных задач
+    */
+    class ThreadPool {
+    public:
+        explicit ThreadPool(size_t thread_count = DefaultThreadCount());
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator= (const ThreadPool&) = delete;
+
+        ~ThreadPool();
+
+        // Ставит задачу в очередь и возвращает future её результата
+        template <typename Func>
+        std::future<std::invoke_result_t<Func>> Submit(Func func);
+
+        // Метод возвращает количество рабочих потоков
+        size_t Size() const {
+            return workers_.size();
+        }
+
+        // Количество потоков по умолчанию - число аппаратных потоков, но не меньше одного
+        static size_t DefaultThreadCount();
+
+        // Общий пул процесса с количеством потоков по умолчанию. Создаётся при первом обращении
+        static ThreadPool& Shared();
+
+    private:
+        void Push(std::function<void()>&& task);
+        void Work();
+
+    private:
+        std::vector<std::thread> workers_;
+        std::queue<std::function<void()>> tasks_;
+        std::mutex mutex_;
+        std::condition_variable condition_;
+        bool is_stopped_ = false;
+    };
+
+    template <typename Func>
+    std::future<std::invoke_result_t<Func>> ThreadPool::Submit(Func func) {
+        using Result = std::invoke_result_t<Func>;
+
+        // std::function требует копируемого объекта, поэтому задача хранится в shared_ptr
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+        std::future<Result> result = task->get_future();
+        Push([task] {
+            (*task)();
+        });
+        return result;
+    }
+
+    namespace detail {
+
+        /*
+        * Общее состояние пакетов ForEachOrdered. Пакеты берутся в работу строго по порядку
+        * номеров и задачами пула, и вызывающим потоком, поэтому вызывающий поток сам выполняет
+        * пакет, до которого не дошли занятые другой работой потоки пула
+        */
+        template <typename Result>
+        struct OrderedBatches {
+            struct Batch {
+                std::vector<Result> results;
+                std::exception_ptr error;
+            };
+
+            std::mutex mutex;
+            std::condition_variable condition;
+            // Номер следующего пакета, который будет взят в работу, и количество пакетов, которые можно брать
+            size_t next = 0;
+            size_t allowed = 0;
+            size_t running = 0;
+            bool is_stopped = false;
+            std::unordered_map<size_t, Batch> done;
+        };
+
+    } // namespace detail
+
+    /*
+    * Вызывает produce(i) для всех i из [0, count) в общем пуле потоков пакетами по batch_size
+    * и передаёт результаты в consume строго по порядку индексов. Одновременно в работе
+    * не больше двух пакетов на поток, поэтому результаты не накапливаются в памяти.
+    * produce вызывается из разных потоков, consume - только из вызывающего.
+    * Если consume вернул false или бросил исключение, следующие пакеты не запускаются,
+    * а выход из функции ждёт только уже выполняющихся. Возвращает количество
+    * переданных в consume результатов, для которых consume вернул true
+    */
+    template <typename Produce, typename Consume>
+    size_t ForEachOrdered(size_t count, size_t batch_size, Produce produce, Consume consume) {
+        using Result = std::invoke_result_t<Produce&, size_t>;
+        using Batches = detail::OrderedBatches<Result>;
+
+        ThreadPool& pool = ThreadPool::Shared();
+        const size_t batch_count = (count + batch_size - 1) / batch_size;
+        const size_t max_in_flight = 2 * pool.Size();
+
+        auto batches = std::make_shared<Batches>();
+
+        // Выполняет следующий по номеру пакет. Вызывается с захваченным мьютексом batches
+        auto run_next = [batches, &produce, count, batch_size](std::unique_lock<std::mutex>& lock) {
+            const size_t batch = batches->next++;
+            ++batches->running;
+            lock.unlock();
+
+            typename Batches::Batch result;
+            try {
+                const size_t begin = batch * batch_size;
+                const size_t end = std::min(begin + batch_size, count);
+                result.results.reserve(end - begin);
+                for (size_t i = begin; i < end; ++i) {
+                    result.results.push_back(produce(i));
+                }
+            }
+            catch (...) {
+                result.error = std::current_exception();
+            }
+
+            lock.lock();
+            batches->done.emplace(batch, std::move(result));
+            --batches->running;
+            batches->condition.notify_all();
+        };
+
+        // Задачи пула могут начаться после выхода из функции, поэтому при выходе новые пакеты
+        // запрещаются и ожидаются только выполняющиеся: лишь они обращаются к produce
+        struct Stop {
+            Batches& batches;
+
+            ~Stop() {
+                std::unique_lock lock(batches.mutex);
+                batches.is_stopped = true;
+                batches.condition.wait(lock, [this] {
+                    return batches.running == 0;
+                });
+            }
+        } stop{ *batches };
+
+        for (size_t batch = 0; batch < batch_count; ++batch) {
+            size_t submit_count = 0;
+            {
+                std::lock_guard lock(batches->mutex);
+                const size_t allowed = std::min(batch_count, batch + max_in_flight);
+                submit_count = allowed - batches->allowed;
+                batches->allowed = allowed;
+            }
+            for (; submit_count > 0; --submit_count) {
+                pool.Submit([batches, run_next]() mutable {
+                    std::unique_lock lock(batches->mutex);
+                    if (!batches->is_stopped && batches->next < batches->allowed) {
+                        run_next(lock);
+                    }
+                });
+            }
+
+            typename Batches::Batch result;
+            {
+                std::unique_lock lock(batches->mutex);
+                if (batches->next == batch) {
+                    run_next(lock);
+                }
+                batches->condition.wait(lock, [&batches, batch] {
+                    return batches->done.count(batch) > 0;
+                });
+                result = std::move(batches->done.extract(batch).mapped());
+            }
+
+            if (result.error) {
+                std::rethrow_exception(result.error);
+            }
+            for (size_t i = 0; i < result.results.size(); ++i) {
+                if (!consume(std::move(result.results[i]))) {
+                    return batch * batch_size + i;
+                }
+            }
+        }
+
+        return count;
+    }
+
+} // namespace thread_pool
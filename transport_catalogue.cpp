@@ -1,20 +1,22 @@
+#include <stdexcept>
+
 #include "transport_catalogue.h"
 
 namespace transport_catalogue {
 
-    void TransportCatalogue::AddBus(bus_catalogue::Bus&& add_bus) {
-        const bus_catalogue::Bus* bus = buses_.PushData(std::move(add_bus));
+    void TransportCatalogue::AddBus(bus_catalogue::BusData&& add_bus) {
+        const bus_catalogue::Bus* bus = buses_.Push(std::move(add_bus), stops_);
 
-        for (const stop_catalogue::Stop* stop : bus->route) {
-            stops_.PushBusToStop(stop, bus->name);
+        for (const stop_catalogue::Stop* stop : bus->GetRoute()) {
+            stops_.PushBusToStop(stop, bus->GetName());
         }
     }
 
-    void TransportCatalogue::AddBus(size_t id, bus_catalogue::Bus&& add_bus) {
-        const bus_catalogue::Bus* bus = buses_.PushData(id, std::move(add_bus));
+    void TransportCatalogue::AddBus(size_t id, bus_catalogue::BusData&& add_bus) {
+        const bus_catalogue::Bus* bus = buses_.Push(id, std::move(add_bus), stops_);
 
-        for (const stop_catalogue::Stop* stop : bus->route) {
-            stops_.PushBusToStop(stop, bus->name);
+        for (const stop_catalogue::Stop* stop : bus->GetRoute()) {
+            stops_.PushBusToStop(stop, bus->GetName());
         }
     }
 
@@ -23,15 +25,11 @@ namespace transport_catalogue {
     }
 
     void TransportCatalogue::AddStop(std::string&& name, Coordinates&& coord) {
-        stops_.Push(std::move(name), std::move(coord));
+        stops_.Push(name, coord);
     }
 
     void TransportCatalogue::AddStop(size_t id, std::string&& name, Coordinates&& coord) {
-        stops_.Push(id, std::move(name), std::move(coord));
-    }
-
-    void TransportCatalogue::AddStop(size_t id, stop_catalogue::Stop&& stop) {
-        stops_.Push(id, std::move(stop));
+        stops_.Push(id, name, coord);
     }
 
     void TransportCatalogue::AddDistanceBetweenStops(const std::string_view& stop_from_name, const std::string_view& stop_to_name, double distance) {
@@ -60,4 +58,101 @@ namespace transport_catalogue {
         buses_.SetRouteSettings(std::move(settings));
     }
 
+    TransportCatalogueBuilder::NameId TransportCatalogueBuilder::GetStopNameId(std::string_view name) {
+        if (auto it = name_to_id_.find(name); it != name_to_id_.end()) {
+            return it->second;
+        }
+        const NameId id = static_cast<NameId>(names_.size());
+        const std::string& stored = names_.emplace_back(name);
+        name_to_id_.emplace(stored, id);
+        coords_.emplace_back(std::nullopt);
+        return id;
+    }
+
+    TransportCatalogueBuilder& TransportCatalogueBuilder::AddStop(std::string_view name, Coordinates coord) {
+        const NameId id = GetStopNameId(name);
+        if (!coords_[id]) {
+            stop_order_.push_back(id);
+        }
+        coords_[id] = coord;
+        return *this;
+    }
+
+    TransportCatalogueBuilder& TransportCatalogueBuilder::AddDistance(std::string_view name_from, std::string_view name_to, double distance) {
+        return AddDistance(GetStopNameId(name_from), GetStopNameId(name_to), distance);
+    }
+
+    TransportCatalogueBuilder& TransportCatalogueBuilder::AddDistance(NameId from, NameId to, double distance) {
+        distances_.push_back({ from, to, distance });
+        return *this;
+    }
+
+    TransportCatalogueBuilder& TransportCatalogueBuilder::AddBus(std::string&& name, RouteType route_type, const std::vector<std::string_view>& stop_names) {
+        std::vector<NameId> stop_ids;
+        stop_ids.reserve(stop_names.size());
+        for (std::string_view stop_name : stop_names) {
+            stop_ids.push_back(GetStopNameId(stop_name));
+        }
+        return AddBus(std::move(name), route_type, std::move(stop_ids));
+    }
+
+    TransportCatalogueBuilder& TransportCatalogueBuilder::AddBus(std::string&& name, RouteType route_type, std::vector<NameId>&& stop_ids) {
+        buses_.push_back({ std::move(name), route_type, std::move(stop_ids) });
+        return *this;
+    }
+
+    void TransportCatalogueBuilder::Commit(TransportCatalogue& catalogue) {
+        using namespace std::string_literals;
+
+        TransportCatalogue result;
+        result.stops_.Reserve(stop_order_.size(), 2 * distances_.size());
+        size_t route_stop_count = 0;
+        for (const StagedBus& staged : buses_) {
+            route_stop_count += staged.stop_ids.size();
+        }
+        result.buses_.Reserve(buses_.size(), route_stop_count);
+
+        // Номер имени -> созданная остановка, имена без остановки остаются nullptr
+        std::vector<const stop_catalogue::Stop*> name_id_to_stop(names_.size(), nullptr);
+        for (size_t id = 0; id < stop_order_.size(); ++id) {
+            const NameId name_id = stop_order_[id];
+            name_id_to_stop[name_id] = result.stops_.Push(id, names_[name_id], *coords_[name_id]);
+        }
+
+        for (const StagedDistance& staged : distances_) {
+            const stop_catalogue::Stop* from = name_id_to_stop[staged.from];
+            const stop_catalogue::Stop* to = name_id_to_stop[staged.to];
+            if (!from || !to) {
+                throw std::logic_error("Distance refers to unknown stop \""s + names_[from ? staged.to : staged.from] + "\""s);
+            }
+            result.stops_.AddDistance(from, to, staged.distance);
+        }
+
+        for (size_t id = 0; id < buses_.size(); ++id) {
+            StagedBus& staged = buses_[id];
+
+            std::vector<const stop_catalogue::Stop*> route;
+            route.reserve(staged.stop_ids.size());
+            for (NameId stop_id : staged.stop_ids) {
+                // Как и при поштучной загрузке, неизвестные остановки в маршруте пропускаются
+                if (const stop_catalogue::Stop* stop = name_id_to_stop[stop_id]) {
+                    route.push_back(stop);
+                }
+            }
+
+            result.AddBus(id, bus_catalogue::BusHelper()
+                .SetName(std::move(staged.name))
+                .SetRouteType(staged.route_type)
+                .SetRoute(std::move(route))
+                .Build(result.stops_));
+        }
+
+        result.buses_.SetRouteSettings(RouteSettings(catalogue.buses_.GetRouteSettings()));
+
+        catalogue = std::move(result);
+
+        // Накопленные данные скопированы в каталог и больше не нужны
+        *this = TransportCatalogueBuilder();
+    }
+
 }
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
+#include <optional>
 #include <set>
 #include <string>
 #include <string_view>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -11,13 +15,15 @@
 
 namespace transport_catalogue {
 
+    class TransportCatalogueBuilder;
+
     class TransportCatalogue {
     public:
         TransportCatalogue() = default;
 
-        void AddBus(bus_catalogue::Bus&& add_bus);
+        void AddBus(bus_catalogue::BusData&& add_bus);
 
-        void AddBus(size_t id, bus_catalogue::Bus&& add_bus);
+        void AddBus(size_t id, bus_catalogue::BusData&& add_bus);
 
         void AddStop(std::string&& name, std::string&& string_coord);
 
@@ -25,8 +31,6 @@ namespace transport_catalogue {
 
         void AddStop(size_t id, std::string&& name, Coordinates&& coord);
 
-        void AddStop(size_t id, stop_catalogue::Stop&& stop);
-
         void AddDistanceBetweenStops(const std::string_view& stop_from_name, const std::string_view& stop_to_name, double distance);
 
         const stop_catalogue::BusesToStopNames& GetBusesForStop(const std::string_view& name) const;
@@ -48,8 +52,62 @@ namespace transport_catalogue {
         }
 
     private:
+        friend class TransportCatalogueBuilder;
+
         bus_catalogue::Catalogue buses_;
         stop_catalogue::Catalogue stops_;
     };
 
+    /*
+    * Класс для пакетной загрузки каталога.
+    * Накапливает остановки, расстояния и маршруты, переводя имена остановок в номера
+    * при первом упоминании, а в Commit собирает каталог с точно зарезервированной памятью
+    * и только после успешной сборки заменяет им содержимое целевого каталога.
+    * Объект рассчитан на однократное использование.
+    */
+    class TransportCatalogueBuilder {
+    public:
+        using NameId = uint32_t;
+
+        TransportCatalogueBuilder() = default;
+
+        // Возвращает номер имени остановки, регистрируя имя при первом упоминании
+        NameId GetStopNameId(std::string_view name);
+
+        TransportCatalogueBuilder& AddStop(std::string_view name, Coordinates coord);
+
+        TransportCatalogueBuilder& AddDistance(std::string_view name_from, std::string_view name_to, double distance);
+
+        TransportCatalogueBuilder& AddDistance(NameId from, NameId to, double distance);
+
+        TransportCatalogueBuilder& AddBus(std::string&& name, RouteType route_type, const std::vector<std::string_view>& stop_names);
+
+        TransportCatalogueBuilder& AddBus(std::string&& name, RouteType route_type, std::vector<NameId>&& stop_ids);
+
+        // Собирает каталог и атомарно заменяет им содержимое catalogue, после чего освобождает
+        // накопленные данные. При ошибке (расстояние до неизвестной остановки) catalogue не изменяется
+        void Commit(TransportCatalogue& catalogue);
+
+    private:
+        struct StagedDistance {
+            NameId from;
+            NameId to;
+            double distance;
+        };
+
+        struct StagedBus {
+            std::string name;
+            RouteType route_type;
+            std::vector<NameId> stop_ids;
+        };
+
+    private:
+        std::deque<std::string> names_;
+        std::unordered_map<std::string_view, NameId> name_to_id_;
+        std::vector<std::optional<Coordinates>> coords_;
+        std::vector<NameId> stop_order_;
+        std::vector<StagedDistance> distances_;
+        std::vector<StagedBus> buses_;
+    };
+
 } // namespace transport_catalogue
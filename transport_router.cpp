@@ -16,7 +16,10 @@ namespace transport_graph {
     void TransportGraph::CreateDiagonalEdges(const TransportCatalogue& catalogue) {
         const double time = static_cast<double>(catalogue.GetBuses().GetRouteSettings().bus_wait_time);
 
-        for (const auto& [stop_ptr, vertex_id] : stop_to_vertex_id_) {
+        // Остановки перебираются в порядке нумерации вершин, а не по адресам в stop_to_vertex_id_,
+        // чтобы номера рёбер, а с ними и файл базы, не менялись от запуска к запуску
+        for (const auto& [stop_name, stop_ptr] : catalogue.GetStops()) {
+            const VertexIdLoop& vertex_id = stop_to_vertex_id_.at(stop_ptr);
             graph::EdgeId id = graph_.AddEdge({ vertex_id.transfer_id, vertex_id.id, time });
 
             edge_id_to_graph_data_.insert({ id, { stop_ptr, stop_ptr, nullptr, 0, time } });
@@ -30,7 +33,7 @@ namespace transport_graph {
 
             CreateEdges(edges, CreateTransportGraphData(ranges::AsBusRangeDirect(bus_ptr), catalogue));
 
-            if (bus_ptr->route_type == RouteType::BackAndForth) {
+            if (bus_ptr->GetRouteType() == RouteType::BackAndForth) {
                 CreateEdges(edges, CreateTransportGraphData(ranges::AsBusRangeReversed(bus_ptr), catalogue));
             }
         }